@@ -436,22 +436,8 @@ void DownloadData() {
     file.print(", ");
     file.println("D2State");
 
-    for (i = 1; i <= SSD.getLastRecord(); i++) {
-      SSD.gotoRecord(i);
-      file.print(SSD.getField(recordsetID, rID));
-      file.print(", ");
-      file.print(SSD.getField(Point, rPoint));
-      file.print(", ");
-      file.print(SSD.getField(A0Volts, rA0Volts), 4);
-      file.print(", ");
-      file.print(SSD.getField(A1Volts, rA1Volts), 4);
-      file.print(", ");
-      file.print(SSD.getField(A2Volts, rA2Volts));
-      file.print(", ");
-      file.print(SSD.getField(A3Volts, rA3Volts));
-      file.print(", ");
-      file.println(SSD.getField(D2State, rD2State));
-    }
+    // scan streams many records per chip read and calls ExportRecord for each one
+    SSD.scan(1, SSD.getLastRecord(), ExportRecord);
 
     file.println("Record printing complete.");
     file.close();
@@ -465,4 +451,25 @@ void DownloadData() {
 }
 
 
+// called by scan for each record, getField reads from the scan buffer
+bool ExportRecord(uint32_t Record) {
+
+  file.print(SSD.getField(recordsetID, rID));
+  file.print(", ");
+  file.print(SSD.getField(Point, rPoint));
+  file.print(", ");
+  file.print(SSD.getField(A0Volts, rA0Volts), 4);
+  file.print(", ");
+  file.print(SSD.getField(A1Volts, rA1Volts), 4);
+  file.print(", ");
+  file.print(SSD.getField(A2Volts, rA2Volts));
+  file.print(", ");
+  file.print(SSD.getField(A3Volts, rA3Volts));
+  file.print(", ");
+  file.println(SSD.getField(D2State, rD2State));
+
+  // keep going
+  return true;
+}
+
 // end of example
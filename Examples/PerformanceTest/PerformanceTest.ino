@@ -27,6 +27,10 @@ Winbond 25Q64JVSIQ with Teensy 4.0
 8. Time to read 100 records (NORMAL SPEED)... [us/record]: 13.83, [us/byte]: 0.41
 9. Time to read 100 records (FAST SPEED)...[us/record]: 11.79, [us/byte]: 0.35
 
+Note: the numbers above were taken when getField read the chip one byte per command. Fields are now
+served from a record buffer that is filled with one FASTREAD per record, test 9 reads every field of
+each record and reports the effective bytes/second
+
 */
 
 // include the database library
@@ -39,7 +43,7 @@ Winbond 25Q64JVSIQ with Teensy 4.0
 #define SENSOR3_PIN 7
 
 // careful the max char len is controlled by MAXDATACHARLEN in the .h file
-char RecordName[MAXDATACHARLEN];
+char RecordName[TEENSYDB_MAXDATACHARLEN];
 
 // required ID's to store the created field ID's
 uint8_t rID = 0, rPoint = 0, rA0Volts = 0, rA1Volts = 0;
@@ -53,7 +57,7 @@ uint8_t D2State = 0;
 uint32_t Counter = 0, oldTime = 0;
 uint32_t Point = 0;
 
-int16_t i = 0;
+int32_t i = 0;
 int32_t Ret = 0;
 int32_t Timer = 0;
 // create the database driver object
@@ -173,9 +177,32 @@ void setup() {
   Serial.print("Total Time [us]: ");
   Serial.print(micros() - Timer);
   Serial.print(", time [us/record]: ");
-  Serial.print((micros() - Timer) / 100);
+  Serial.print((micros() - Timer) / 5000);
   Serial.print(", [us/byte]: ");
-  Serial.println((float)(micros() - Timer) / (float)(100 * SSD.getRecordLength()));
+  Serial.print((float)(micros() - Timer) / (float)(5000 * SSD.getRecordLength()));
+  Serial.print(", [records/second]: ");
+  Serial.println(5000.0 * 1000000.0 / (float)(micros() - Timer));
+  delay(1000);
+  Serial.println();
+
+  // same test with write combining, records are held in RAM until a full page
+  // is ready so the page program time is paid once per page, not once per record
+  Serial.println("Time to add and save 5000 records (write combining)...");
+  SSD.setWriteCombine(true);
+  Timer = micros();
+  for (i = 0; i < 5000; i++) {
+    SSD.addRecord();
+    SSD.saveRecord();
+  }
+  SSD.flush();
+  Timer = micros() - Timer;
+  SSD.setWriteCombine(false);
+  Serial.print("Total Time [us]: ");
+  Serial.print(Timer);
+  Serial.print(", time [us/record]: ");
+  Serial.print(Timer / 5000);
+  Serial.print(", [records/second]: ");
+  Serial.println(5000.0 * 1000000.0 / (float)Timer);
   delay(1000);
   Serial.println();
 
@@ -189,10 +216,8 @@ void setup() {
   Serial.println();
 
 
-  Serial.println("Time to read 100 records (NORMAL SPEED)...");
-  SSD.setReadSpeed(READ_NORMAL);  // this is the default
+  Serial.println("Time to read 100 records, one field each...");
   Timer = micros();
-
   for (i = 1; i <= 100; i++) {
     SSD.gotoRecord(i);
     SSD.getField(Point, rPoint);
@@ -204,19 +229,54 @@ void setup() {
   Serial.println();
   delay(1000);
 
-  Serial.println("Time to read 100 records (FAST SPEED)...");
-  SSD.setReadSpeed(READ_FAST);  // this is the default
+  // the first getField for a record pulls the whole record in one FASTREAD
+  // so the remaining fields are read from the record buffer
+  Serial.println("Time to read 100 records, every field...");
   Timer = micros();
   for (i = 1; i <= 100; i++) {
     SSD.gotoRecord(i);
+    SSD.getCharField(rCharTest);
+    SSD.getField(recordsetID, rID);
     SSD.getField(Point, rPoint);
+    SSD.getField(A0Volts, rA0Volts);
+    SSD.getField(A1Volts, rA1Volts);
+    SSD.getField(D2State, rD2State);
   }
+  Timer = micros() - Timer;
   Serial.print("Time [us/record]: ");
-  Serial.print((micros() - Timer) / 100.0);
-  Serial.print(", [us/byte]: ");
-  Serial.println((micros() - Timer) / (100.0 * SSD.getRecordLength()));
+  Serial.print(Timer / 100.0);
+  Serial.print(", [bytes/second]: ");
+  Serial.println((100.0 * SSD.getRecordLength() * 1000000.0) / Timer);
   delay(1000);
   Serial.println();
+
+  // the library keeps its own counters and latency histograms, no micros() needed
+  TeensyDBStats Stats = SSD.getStats();
+  Serial.println("Library stats since init...");
+  Serial.print("Reads: ");
+  Serial.print(Stats.Reads);
+  Serial.print(", programs: ");
+  Serial.print(Stats.Programs);
+  Serial.print(", erases: ");
+  Serial.print(Stats.Erases);
+  Serial.print(", status polls: ");
+  Serial.print(Stats.StatusPolls);
+  Serial.print(", timeouts: ");
+  Serial.println(Stats.Timeouts);
+  Serial.print("Worst saveRecord [us]: ");
+  Serial.print(Stats.Latency[LATENCY_SAVE].Max);
+  Serial.print(", worst page program wait [us]: ");
+  Serial.println(Stats.Latency[LATENCY_PROGRAM].Max);
+  Serial.println("saveRecord [us]   count");
+  for (i = 0; i < TEENSYDB_HISTOGRAM; i++) {
+    if (Stats.Latency[LATENCY_SAVE].Bucket[i] > 0) {
+      Serial.print("< ");
+      Serial.print(1UL << i);
+      Serial.print("   ");
+      Serial.println(Stats.Latency[LATENCY_SAVE].Bucket[i]);
+    }
+  }
+  Serial.println();
   Serial.print("DBase Library performance tests complete...");
 }
 
@@ -23,53 +23,87 @@
 
 */
 
-#include "SPI.h"
 #include "TeensyDB.h"
 
-TeensyDB::TeensyDB(int CS_PIN) {
+#ifdef ARDUINO
+
+TeensyDB::TeensyDB(int CS_PIN) : SPIBus(CS_PIN), SPIFlash(&SPIBus) {
+	
+  Device = &SPIFlash;
+  Chip = &Device->getProfile();
+  
+}
+
+TeensyDB::TeensyDB(TeensyDBBus &UserBus) : SPIBus(0xFF), SPIFlash(&UserBus) {
+	
+  Device = &SPIFlash;
+  Chip = &Device->getProfile();
+  
+}
+
+TeensyDB::TeensyDB(TeensyDBDevice &UserDevice) : SPIBus(0xFF), SPIFlash(NULL) {
+	
+  Device = &UserDevice;
+  Chip = &Device->getProfile();
+  
+}
+
+#else
+
+TeensyDB::TeensyDB(TeensyDBBus &UserBus) : SPIFlash(&UserBus) {
+	
+  Device = &SPIFlash;
+  Chip = &Device->getProfile();
+  
+}
+
+TeensyDB::TeensyDB(TeensyDBDevice &UserDevice) : SPIFlash(NULL) {
 	
-  CSPin = CS_PIN;
+  Device = &UserDevice;
+  Chip = &Device->getProfile();
   
 }
 
+#endif
+
 bool TeensyDB::init() {
 	
 	FieldCount = 0;
+	RecordLength = 0;
+	BitEnd = 0;
+	BitLimit = 0;
+	CheckLength = 0;
+	CheckStart = 0;
+	ReadOnly = false;
+	SchemaBad = false;
+	memset(FieldName, 0, sizeof(FieldName));
 	CurrentRecord = 0;
+	KeyField = 0;
+	IndexBuilt = false;
+	ZoneLoaded = false;
 	MaxRecords = 0;
 	
 	ReadComplete = false;
 	
-	SPI.begin();
-	
-	// im not a fan of delays, but some chips pin recovery is not as fast as expcted
-	delay(20);	
-	pinMode(CSPin, OUTPUT);
-
-	digitalWrite(CSPin, HIGH);
-	delay(20);	
+	Device->begin();
+	resetStats();
 	
 	initStatus = readChipJEDEC();
+	
+	// pick the chip profile from the JEDEC ID, unknown chips get the defaults from TeensyDB.h
+	if (initStatus) {
+		TeensyDBFindChip(ChipID, &Profile);
+		Device->setProfile(Profile);
+	}
 
 	return initStatus;
 }
 
  bool TeensyDB::readChipJEDEC(){
 	 
-	uint8_t byteID[3];
-
-	SPI.beginTransaction(SPISettings(SPEED_WRITE, MSBFIRST, SPI_MODE0));
-	digitalWrite(CSPin, LOW);
-	delay(10);
-	
-	SPI.transfer(JEDEC);
-
-	byteID[0] = SPI.transfer(0x00);
-	byteID[1] = SPI.transfer(0x00);
-	byteID[2] = SPI.transfer(0x00);
+	uint8_t *byteID = ChipID;
 
-	digitalWrite(CSPin, HIGH);
-	SPI.endTransaction();
+	Device->readJEDEC(byteID);
 	
 	if ((byteID[0] == 0) || (byteID[0] == NULL_RECORD)) {
 		strcpy(ChipJEDEC,"INVALID CHIP");
@@ -92,21 +126,7 @@ bool TeensyDB::init() {
  
  void TeensyDB::getUniqueID(uint8_t *ByteID){
 	 
-	SPI.beginTransaction(SPISettings(SPEED_WRITE, MSBFIRST, SPI_MODE0));
-	digitalWrite(CSPin, LOW);
-	delay(10);
-	
-	SPI.transfer(UNIQUEID);
-
-	SPI.transfer(0x00);
-	SPI.transfer(0x00);
-	SPI.transfer(0x00);
-	SPI.transfer(0x00);
-	
-	SPI.transfer(ByteID, 8);
-	
-	digitalWrite(CSPin, HIGH);
-	SPI.endTransaction();
+	Device->readUniqueID(ByteID);
 	
  }
  
@@ -118,6 +138,39 @@ bool TeensyDB::init() {
 	
 }
 
+const char *TeensyDB::getChipName(){
+	
+	return Chip->Name;
+	
+}
+
+const TeensyDBChipProfile *TeensyDB::getChipProfile(){
+	
+	return Chip;
+	
+}
+
+uint8_t TeensyDB::setReadLanes(uint8_t Lanes){
+	
+	return Device->setReadLanes(Lanes);
+	
+}
+
+void TeensyDB::setChipProfile(const TeensyDBChipProfile &Profile){
+	
+	// nothing pending may be written with the old geometry
+	flush();
+	
+	Device->setProfile(Profile);
+	
+	if (RecordLength > 0) {
+		findMaxRecords();
+	}
+	
+	RecordCached = false;
+	
+}
+
 /*
 
 Since flash chips tend to not allow writing over existing data. This library writes in sequential order on the chip
@@ -146,893 +199,3977 @@ record data
 
 Also note that this database driver is 1 based meaning the first record is 1 and NOT 0.
 
+a record is unwritten only if every byte of it is 0xFF, so a first field that is legitimately 255 does not look
+like the end of the data. with checkpoints on (setCheckpoint) the search only covers the few records after the
+last checkpoint, the search of the whole chip is only used if the checkpoint is missing or does not match the data
 
 */
 
 
-uint32_t TeensyDB::findFirstWritableRecord(){
-	
-	
-	uint8_t RecType = 0;
-	uint32_t StartRecord = 0;
-	uint32_t MiddleRecord = 0;
-	uint32_t EndRecord = 0;
-	bool Found = false;
-	uint8_t NextRecType = 0;
-	uint32_t Iteration = 0;
-	uint32_t MaxIteration = 0;
-
+/*
 
-	// we must have some defined fields in order to compute record length
-	if (RecordLength == 0) {
-		// no fields
-		NewCard = false;
-		CurrentRecord = 0;
-		LastRecord = 0;
-		ReadComplete = false;
-		return NO_FIELDS;
-	}
+record checks, with setRecordCheck(true) every record ends with a CRC-16 of its fields and a commit marker. page
+programs write bytes in address order, so a record that was cut off by a power loss (or only got the first of the two
+programs when it spans a page) is missing its marker or fails the CRC. only the last record is checked at boot, the
+next record goes after it either way (a partly programmed record can't be written over). records that fail are skipped
+by scan, scanWhere and aggregate, and getField returns 0 for their fields, see isRecordValid. records that were never
+written are not counted as bad
 
-	// find the maximum iterations to prevent runaway in cases where the chip was not properly erased
-	// or only portions were erased--leaving gaps in data
-	// such case will not let us find the first writabel record
-	// to elimitate round off errors, add 1 more iteration
-	MaxIteration = (log(CARD_SIZE) / log(2)) + 1;
+*/
 
-	// get maximum possible records
-	// can't more records that memory
-	MaxRecords = CARD_SIZE / RecordLength;
-	// we back out one record to accomodate a possible partial record
-	// we back out one more since were' not starting at 0;
-	MaxRecords = MaxRecords - 2;
-	
-	// test the first record
-	gotoRecord(1);
-	RecType = readByte();
+bool TeensyDB::setRecordCheck(bool Enable){
 	
-	if (RecType == NULL_RECORD){
-		// no DATA
-		NewCard = true;
-		CurrentRecord = 0;
-		LastRecord = 0;
-		ReadComplete = true;
-		return CHIP_NEW;
+	// the check bytes go after the fields, so the fields must already be added
+	if (Enable && (CheckLength == 0) && ((RecordLength + 3) > TEENSYDB_MAXREXORDLENGTH)){
+		return false;
 	}
 	
-	// test the last record
-	gotoRecord(MaxRecords);
-	
-	RecType = readByte();
-
-	if (RecType != NULL_RECORD){
-		// card full
-		NewCard = false;
-		CurrentRecord = MaxRecords;
-		LastRecord = MaxRecords;
-		ReadComplete = true;
-		return CHIP_FULL;
+	if (Enable && (CheckLength == 0)){
+		CheckStart = RecordLength;
+		CheckLength = 3;
+		RecordLength = RecordLength + CheckLength;
 	}
-	/*
-	// record crawling scheme, slow
-	for (i = 1; i < MaxRecords; i++){
-		gotoRecord(i);
-		RecType = readByte();
-		
-		if (RecType == NULL_RECORD){
-			NewCard = false;
-			LastRecord = i;
-			ReadComplete = true;
-			return LastRecord;
-		}
-		
+	else if ((!Enable) && (CheckLength > 0)){
+		RecordLength = CheckStart;
+		CheckLength = 0;
 	}
-	*/
 	
-	// much faster alternative to finding the first writable record
-	// begin the bisectional seek to get the last valid record 
-	// (where record start address is not 0xFFFF and next record IS 0xFFFF)
-	StartRecord = 1;
-	EndRecord = MaxRecords;
-		
-	// OK last record is somewhere in between...
-	while(!Found) {
-		
-		Iteration++;
-		
-		MiddleRecord = (EndRecord + StartRecord) / 2;
-		Address = MiddleRecord * RecordLength;
-		RecType = readByte();
-		Address = (MiddleRecord + 1)  * RecordLength;
-		NextRecType = readByte();
+	RecordCached = false;
 	
-		if ((RecType == NULL_RECORD) && (NextRecType == NULL_RECORD)){
-			// first writabel record must be before middle record
-			EndRecord = MiddleRecord;
-		}
-		if ((RecType != NULL_RECORD) && (NextRecType != NULL_RECORD)){
-			// first writabel record must be after middle record
-			StartRecord = MiddleRecord;
-		}
-		if ((RecType != NULL_RECORD) && (NextRecType == NULL_RECORD)){
-			// we found first writabel record
-			LastRecord = MiddleRecord;
-			Found = true;
-		}
-		if ((RecType == NULL_RECORD) && (NextRecType != NULL_RECORD)){
-			// properly erased chip, this case should never be encountered
-			// this means record 1 is NULL and next record has data
-			// consider the chip full
-			NewCard = false;
-			CurrentRecord = MaxRecords;
-			LastRecord = MaxRecords;
-			ReadComplete = true;
-			getAddress();
-			return LastRecord;
-		}
-		
-		if (Iteration > MaxIteration) {
-			// this should never happen, but if the card was not fully erased where
-			// there are gaps in used space, we may never find the first writabel record
-			NewCard = true;
-			MiddleRecord = 0;
-			CurrentRecord = 0;
-			LastRecord = 0;
-			ReadComplete = true;
-			getAddress();
-			return CHIP_FORCE_RESTART;
-		}
-			
+	if (RecordLength > 0) {
+		findMaxRecords();
 	}
 	
+	return true;
 	
-	NewCard = false;
-	LastRecord = MiddleRecord;
-	CurrentRecord = MiddleRecord;
-	getAddress();
-	ReadComplete = true;
+}
+
+bool TeensyDB::isRecordValid(){
 	
-	return LastRecord;
+	loadRecord();
+	
+	return RecordValid;
 	
 }
 
-void TeensyDB::findMaxRecords(){
-	// get maximum possible records
-	// we back out one record to accomodate a possible partial record
-	// we back out one more since were' not starting at 0 but record 1;
-	MaxRecords = (CARD_SIZE / RecordLength) - 2;
+uint32_t TeensyDB::getBadRecords(){
+	
+	return BadRecords;
+	
 }
 
-// data field addField methods
-uint8_t TeensyDB::addField(uint8_t *Data) {
-		
-	if (FieldCount > MAX_FIELDS){
+uint32_t TeensyDB::verifyRecords(){
+	
+	uint32_t Record = getFirstRecord();
+	uint32_t Chunk = 0;
+	uint32_t r = 0;
+	const uint8_t *Bytes;
+	
+	BadRecords = 0;
+	
+	if ((CheckLength == 0) || (LastRecord == 0)){
 		return 0;
 	}
 	
-	FieldCount++;
+	while (Record <= LastRecord){
+		
+		Chunk = chunkRecords(Record, LastRecord);
+		readRecords(Record, SCANBUF[0], Chunk);
+		
+		for (r = 0; r < Chunk; r++){
+			Bytes = &SCANBUF[0][r * RecordLength];
+			if ((!checkRecord(Bytes)) && (!isErased(Bytes, RecordLength))){
+				BadRecords++;
+			}
+		}
+		
+		Record = Record + Chunk;
+	}
+	
+	return BadRecords;
 	
-	DataType[FieldCount] = DT_U8;
-	FieldStart[FieldCount] = RecordLength;
-	FieldLength[FieldCount] =  sizeof(*Data);
-	RecordLength = RecordLength + sizeof(*Data);
-	u8data[FieldCount] = Data;
-	findMaxRecords();
-	return FieldCount;
 }
 
-uint8_t TeensyDB::addField(int *Data) {
-	if (FieldCount > MAX_FIELDS){
-		return 0;
+uint16_t TeensyDB::crc16(const uint8_t *Bytes, uint16_t Length){
+	
+	// CRC-16/CCITT-FALSE
+	uint16_t CRC = 0xFFFF;
+	uint16_t k = 0;
+	uint8_t b = 0;
+	
+	for (k = 0; k < Length; k++){
+		CRC = CRC ^ ((uint16_t) Bytes[k] << 8);
+		for (b = 0; b < 8; b++){
+			CRC = (CRC & 0x8000) ? ((CRC << 1) ^ 0x1021) : (CRC << 1);
+		}
 	}
-	FieldCount++;
-	DataType[FieldCount] = DT_INT;
-	FieldStart[FieldCount] = RecordLength;
-	FieldLength[FieldCount] =  sizeof(*Data);
-	RecordLength = RecordLength + sizeof(*Data);
-	intdata[FieldCount] = Data;
-	findMaxRecords();
-	return FieldCount;
+	
+	return CRC;
+	
 }
 
-uint8_t TeensyDB::addField(int16_t *Data) {
-	if (FieldCount > MAX_FIELDS){
-		return 0;
+bool TeensyDB::checkRecord(const uint8_t *Bytes){
+	
+	if (CheckLength == 0){
+		return true;
 	}
 	
-	FieldCount++;
+	return (Bytes[CheckStart + 2] == TEENSYDB_COMMIT) && (((Bytes[CheckStart] << 8) | Bytes[CheckStart + 1]) == crc16(Bytes, CheckStart));
 	
-	DataType[FieldCount] = DT_I16;
-	FieldStart[FieldCount] = RecordLength;
-	FieldLength[FieldCount] =  sizeof(*Data);
-	RecordLength = RecordLength + sizeof(*Data);
-	i16data[FieldCount] = Data;
-	findMaxRecords();
-	return FieldCount;
 }
 
-uint8_t TeensyDB::addField(uint16_t *Data) {
-	if (FieldCount > MAX_FIELDS){
-		return 0;
+/*
+
+schema, with setSchema(true) the first sector of the chip describes the data: the field list (type, length, bit
+position, scale and name of each field) and the settings that change where records are (checkpoints, ring mode,
+zone maps, compression and record checks). findFirstWritableRecord writes it to a new chip and on every boot after
+compares it with the fields that were added, a different field list is refused (SCHEMA_MISMATCH) instead of
+corrupting the data. loadSchema goes the other way and builds the field table from the chip, so a program that
+knows nothing about the logger can read any chip with getFieldValue / getCharField.
+
+the block is "TDB1", its length, a CRC-16 of the rest, the length of the layout part, then the layout (record length,
+settings and fields) and last the field names. only the layout has to match, names can change. the block is built
+in one half of the scan buffer, so the layout caps the field count: setSchema refuses a longer field list and
+addField refuses the field that would make it one
+
+*/
+
+bool TeensyDB::setSchema(bool Enable){
+	
+	if (Enable && (!schemaFits(FieldCount))){
+		return false;
 	}
 	
-	FieldCount++;
+	Schema = Enable;
+	MetaStart = Schema ? Chip->SectorSize : 0;
+	
+	// a table keeps its schema in its first extent, the directory comes first
+	if (Table > 0){
+		MetaStart = (((Chip->Capacity / Chip->SectorSize) + Chip->SectorSize - 1) / Chip->SectorSize) * Chip->SectorSize;
+	}
+	
+	// checkpoints (if used) come after the schema
+	setCheckpoint(CheckpointInterval);
+	
+	return true;
 	
-	DataType[FieldCount] = DT_U16;
-	FieldStart[FieldCount] = RecordLength;
-	FieldLength[FieldCount] =  sizeof(*Data);
-	RecordLength = RecordLength + sizeof(*Data);
-	u16data[FieldCount] = Data;
-	findMaxRecords();	
-	return FieldCount;
 }
 
-uint8_t TeensyDB::addField(int32_t *Data) {
-	if (FieldCount > MAX_FIELDS){
-		return 0;
+void TeensyDB::setFieldName(uint8_t Field, const char *Name){
+	
+	if ((Field < 1) || (Field > FieldCount)){
+		return;
 	}
 	
-	FieldCount++;
-	DataType[FieldCount] = DT_I32;
-	FieldStart[FieldCount] = RecordLength;
-	FieldLength[FieldCount] =  sizeof(*Data);
-	RecordLength = RecordLength + sizeof(*Data);
-	i32data[FieldCount] = Data;
-	findMaxRecords();	
-	return FieldCount;
+	strncpy(FieldName[Field], Name, TEENSYDB_NAMELENGTH - 1);
+	FieldName[Field][TEENSYDB_NAMELENGTH - 1] = '\0';
+	
 }
 
-uint8_t TeensyDB::addField(uint32_t *Data) {
-	if (FieldCount > MAX_FIELDS){
-		return 0;
-	}
-	FieldCount++;
-	DataType[FieldCount] = DT_U32;
-	FieldStart[FieldCount] = RecordLength;
-	FieldLength[FieldCount] =  sizeof(*Data);
-	RecordLength = RecordLength + sizeof(*Data);
-	u32data[FieldCount] = Data;
-	findMaxRecords();	
-	return FieldCount;
+const char *TeensyDB::getFieldName(uint8_t Field){
+	
+	return FieldName[Field];
+	
 }
-uint8_t TeensyDB::addField(float *Data) {
-	if (FieldCount > MAX_FIELDS){
-		return 0;
-	}
+
+uint8_t TeensyDB::getFieldType(uint8_t Field){
 	
-	FieldCount++;
+	return DataType[Field];
 	
-	DataType[FieldCount] = DT_FLOAT;
-	FieldStart[FieldCount] = RecordLength;
-	FieldLength[FieldCount] =  sizeof(*Data);
-	RecordLength = RecordLength + sizeof(*Data);
-	fdata[FieldCount] = Data;
-	findMaxRecords();	
-	return FieldCount;
 }
 
-uint8_t TeensyDB::addField(double *Data) {
-	if (FieldCount > MAX_FIELDS){
+double TeensyDB::getFieldValue(uint8_t Field){
+	
+	loadRecord();
+	
+	if (DataType[Field] == DT_CHAR){
 		return 0;
 	}
 	
-	FieldCount++;
+	return fieldValue(RecPtr, Field);
 	
-	DataType[FieldCount] = DT_DOUBLE;
-	FieldStart[FieldCount] = RecordLength;
-	FieldLength[FieldCount] =  sizeof(*Data);
-	RecordLength = RecordLength + sizeof(*Data);
-	ddata[FieldCount] = Data;
-	findMaxRecords();	
-	return FieldCount;
 }
 
-uint8_t TeensyDB::addField(char *Data, uint8_t len) {
-	if (FieldCount > MAX_FIELDS){
+uint16_t TeensyDB::buildSchema(uint8_t *Block){
+	
+	uint16_t Length = 10;
+	uint8_t f = 0;
+	uint8_t n = 0;
+	uint8_t Flags = 0;
+	
+	Flags = (RingMode ? 1 : 0) | (ZoneMap ? 2 : 0) | (Compress ? 4 : 0) | ((CheckLength > 0) ? 8 : 0);
+	
+	// layout, everything that changes where a field is
+	B2ToBytes(&Block[Length], (uint16_t) (RecordLength - CheckLength));
+	B2ToBytes(&Block[Length + 2], CheckpointInterval);
+	Block[Length + 4] = Flags;
+	Block[Length + 5] = FieldCount;
+	Length = Length + 6;
+	
+	// setSchema and addField keep the field list short enough, this only guards the buffer
+	if (!schemaFits(FieldCount)){
 		return 0;
 	}
 	
-	FieldCount++;
+	for (f = 1; f <= FieldCount; f++){
+		Block[Length] = DataType[f];
+		B2ToBytes(&Block[Length + 1], FieldStart[f]);
+		B2ToBytes(&Block[Length + 3], FieldLength[f]);
+		B2ToBytes(&Block[Length + 5], (uint16_t) (isBitField(f) ? FieldBit[f] : 0));
+		Block[Length + 7] = isBitField(f) ? FieldBits[f] : 0;
+		FloatToBytes(&Block[Length + 8], (DataType[f] == DT_SCALED) ? FieldScale[f] : 0.0f);
+		FloatToBytes(&Block[Length + 12], (DataType[f] == DT_SCALED) ? FieldOffset[f] : 0.0f);
+		Length = Length + 16;
+	}
+	
+	B2ToBytes(&Block[8], (uint16_t) (Length - 10));
+	
+	// then the names, as many as fit
+	for (f = 1; f <= FieldCount; f++){
+		n = strlen(FieldName[f]);
+		if ((Length + 1 + n) > TEENSYDB_SCANBUFFER){
+			break;
+		}
+		Block[Length++] = n;
+		memcpy(&Block[Length], FieldName[f], n);
+		Length = Length + n;
+	}
+	
+	memcpy(Block, "TDB1", 4);
+	B2ToBytes(&Block[4], Length);
+	B2ToBytes(&Block[6], crc16(&Block[8], Length - 8));
+	
+	return Length;
+	
+}
+
+bool TeensyDB::schemaFits(uint16_t Fields){
+	
+	// 16 bytes of header and settings, 16 per field, the names go in if there's room
+	return (16 + (16 * (uint32_t) Fields)) <= TEENSYDB_SCANBUFFER;
+	
+}
+
+uint32_t TeensyDB::schemaAddress(){
+	
+	if (Table > 0){
+		return DataStart + (extentSector(0) * Chip->SectorSize);
+	}
+	
+	return 0;
+	
+}
+
+uint16_t TeensyDB::readSchema(uint8_t *Block){
+	
+	uint16_t Length = 0;
+	
+	if ((Table > 0) && (Extents == 0)){
+		return 0;
+	}
+	
+	readBytes(schemaAddress(), Block, 8);
+	
+	if (memcmp(Block, "TDB1", 4) != 0){
+		return 0;
+	}
+	
+	Length = (Block[4] << 8) | Block[5];
+	
+	if ((Length < 16) || (Length > TEENSYDB_SCANBUFFER)){
+		return 0;
+	}
+	
+	readBytes(schemaAddress(), Block, Length);
+	
+	if (((Block[6] << 8) | Block[7]) != crc16(&Block[8], Length - 8)){
+		return 0;
+	}
+	
+	return Length;
+	
+}
+
+bool TeensyDB::checkSchema(){
+	
+	uint8_t Header[4];
+	uint16_t Length = 0;
+	uint16_t Offset = 0;
+	uint16_t Page = 0;
+	uint32_t Address = 0;
+	
+	// the chip schema goes in one half of the scan buffer, ours in the other
+	Length = buildSchema(SCANBUF[1]);
+	
+	if (Length == 0){
+		return false;
+	}
+	
+	// a new table gets its first extent for the schema
+	if ((Table > 0) && (Extents == 0) && (!allocateExtent())){
+		return false;
+	}
+	
+	Address = schemaAddress();
+	readBytes(Address, Header, 4);
+	
+	// new chip, write ours
+	if (isErased(Header, 4)){
+		
+		readyFor(Address, Length, true);
+		
+		for (Offset = 0; Offset < Length; Offset = Offset + Page){
+			Page = Chip->PageSize;
+			if ((Offset + Page) > Length){
+				Page = Length - Offset;
+			}
+			Device->program(Address + Offset, &SCANBUF[1][Offset], Page);
+			TEENSYDB_STAT(Stats.Programs++);
+			TEENSYDB_STAT(Stats.ProgramBytes += Page);
+			waitForChip(Chip->ProgramTime, LATENCY_PROGRAM);
+		}
+		
+		return true;
+	}
+	
+	if (readSchema(SCANBUF[0]) == 0){
+		return false;
+	}
+	
+	// the layouts must match, the names don't matter
+	Length = 10 + ((SCANBUF[1][8] << 8) | SCANBUF[1][9]);
+	
+	return memcmp(&SCANBUF[0][8], &SCANBUF[1][8], Length - 8) == 0;
+	
+}
+
+int16_t TeensyDB::loadSchema(){
+	
+	uint16_t Length = 0;
+	uint16_t Names = 0;
+	uint16_t Offset = 16;
+	uint16_t Interval = 0;
+	uint8_t Flags = 0;
+	uint8_t *Block = SCANBUF[0];
+	uint8_t f = 0;
+	uint8_t n = 0;
+	
+	if (Table > 0){
+		loadExtents();
+	}
+	
+	Length = readSchema(Block);
+	
+	if (Length == 0){
+		return NO_SCHEMA;
+	}
+	
+	Names = 10 + ((Block[8] << 8) | Block[9]);
+	Interval = (Block[12] << 8) | Block[13];
+	Flags = Block[14];
+	
+	// written with bigger limits than these
+	if ((Block[15] >= MAX_FIELDS) || (((Block[10] << 8) | Block[11]) > TEENSYDB_MAXREXORDLENGTH)){
+		return NO_SCHEMA;
+	}
+	
+	FieldCount = Block[15];
+	RecordLength = (Block[10] << 8) | Block[11];
+	
+	for (f = 1; f <= FieldCount; f++){
+		DataType[f] = Block[Offset];
+		FieldStart[f] = (Block[Offset + 1] << 8) | Block[Offset + 2];
+		FieldLength[f] = (Block[Offset + 3] << 8) | Block[Offset + 4];
+		FieldBit[f] = (Block[Offset + 5] << 8) | Block[Offset + 6];
+		FieldBits[f] = Block[Offset + 7];
+		memcpy(&FieldScale[f], &Block[Offset + 8], 4);
+		memcpy(&FieldOffset[f], &Block[Offset + 12], 4);
+		FieldData[f] = NULL;
+		Offset = Offset + 16;
+		
+		FieldName[f][0] = '\0';
+		if (Names < Length){
+			n = Block[Names];
+			if (n >= TEENSYDB_NAMELENGTH){
+				n = TEENSYDB_NAMELENGTH - 1;
+			}
+			memcpy(FieldName[f], &Block[Names + 1], n);
+			FieldName[f][n] = '\0';
+			Names = Names + 1 + Block[Names];
+		}
+	}
+	
+	// there are no variables behind these fields, they can only be read
+	ReadOnly = true;
+	
+	setSchema(true);
+	CheckLength = 0;
+	setCheckpoint(Interval);
+	setRingMode(Flags & 1);
+	setZoneMap(Flags & 2);
+	setRecordCheck(Flags & 8);
+	setCompression(Flags & 4);
 	
-	DataType[FieldCount] = DT_CHAR;
-	FieldStart[FieldCount] = RecordLength;
-	FieldLength[FieldCount] =  len;
-	RecordLength = RecordLength + len;
-	cdata[FieldCount] = Data;
-	findMaxRecords();	
 	return FieldCount;
+	
+}
+
+/*
+
+tables, setTable(n) makes this object one of up to 254 record streams on the chip, each with its own fields (and
+schema if setSchema is used). the first sectors of the chip are a directory with one byte per data sector, the
+number of the table that owns it or 0xFF if it's free. sectors are handed out in order as the tables fill them so
+the free ones are always at the end and a table's sectors are the ones with its number, in order. records are
+packed into sectors (like zone maps) and record r is in the ((r - 1) / RecordsPerSector)th sector of the table.
+
+findFirstWritableRecord reads the directory once and keeps where every ExtentStride-th sector of the table is, a
+record in any other sector is found by reading forward in the directory from there. reading a table never touches
+the sectors of the others. use one TeensyDB object per table on the same chip (same bus or device), checkpoints,
+ring mode and compression are not available in tables and eraseAll erases every table
+
+*/
+
+bool TeensyDB::setTable(uint8_t Number){
+	
+	// 0xFF is a free sector in the directory
+	if (Number == NULL_RECORD){
+		return false;
+	}
+	
+	flush();
+	
+	Table = Number;
+	Extents = 0;
+	FreeSector = 0;
+	ExtentCached = TEENSYDB_NOBLOCK;
+	
+	// the sectors of a table are not one run, there's nothing for checkpoints, rings or blocks to work with
+	Compress = false;
+	RingMode = false;
+	CheckpointInterval = 0;
+	RecordCached = false;
+	
+	// the directory goes where the schema would, setSchema figures out where the data starts
+	setSchema(Schema);
+	
+	return true;
+	
+}
+
+uint8_t TeensyDB::getTable(){
+	
+	return Table;
+	
+}
+
+uint32_t TeensyDB::getTableSectors(){
+	
+	return Extents;
+	
+}
+
+void TeensyDB::loadExtents(){
+	
+	uint32_t Sector = 0;
+	uint32_t Chunk = 0;
+	uint32_t i = 0;
+	
+	DataSectors = (Chip->Capacity - DataStart) / Chip->SectorSize;
+	ExtentStride = (DataSectors / TEENSYDB_EXTENTINDEX) + 1;
+	ExtentCached = TEENSYDB_NOBLOCK;
+	Extents = 0;
+	FreeSector = DataSectors;
+	
+	// one pass over the directory, it ends at the first free sector
+	for (Sector = 0; Sector < FreeSector; Sector = Sector + Chunk){
+		
+		Chunk = DataSectors - Sector;
+		if (Chunk > TEENSYDB_SCANBUFFER){
+			Chunk = TEENSYDB_SCANBUFFER;
+		}
+		
+		readBytes(Sector, SCANBUF[0], Chunk);
+		
+		for (i = 0; i < Chunk; i++){
+			if (SCANBUF[0][i] == NULL_RECORD){
+				FreeSector = Sector + i;
+				break;
+			}
+			if (SCANBUF[0][i] == Table){
+				if ((Extents % ExtentStride) == 0){
+					ExtentIndex[Extents / ExtentStride] = Sector + i;
+				}
+				Extents++;
+			}
+		}
+	}
+	
+}
+
+bool TeensyDB::allocateExtent(){
+	
+	uint8_t Dir[64];
+	uint32_t Chunk = 0;
+	uint32_t i = 0;
+	
+	// the other tables on the chip may have taken sectors since we last looked
+	while (FreeSector < DataSectors){
+		
+		Chunk = DataSectors - FreeSector;
+		if (Chunk > sizeof(Dir)){
+			Chunk = sizeof(Dir);
+		}
+		
+		readBytes(FreeSector, Dir, Chunk);
+		
+		for (i = 0; (i < Chunk) && (Dir[i] != NULL_RECORD); i++){
+		}
+		
+		FreeSector = FreeSector + i;
+		if (i < Chunk){
+			break;
+		}
+	}
+	
+	if (FreeSector >= DataSectors){
+		return false;
+	}
+	
+	readyFor(FreeSector, 1, true);
+	Device->program(FreeSector, &Table, 1);
+	TEENSYDB_STAT(Stats.Programs++);
+	TEENSYDB_STAT(Stats.ProgramBytes++);
+	waitForChip(Chip->ProgramTime, LATENCY_PROGRAM);
+	
+	if ((Extents % ExtentStride) == 0){
+		ExtentIndex[Extents / ExtentStride] = FreeSector;
+	}
+	
+	ExtentCached = Extents;
+	ExtentSector = FreeSector;
+	Extents++;
+	FreeSector++;
+	
+	return true;
+	
+}
+
+uint32_t TeensyDB::recordExtent(uint32_t Record){
+	
+	// the schema (if used) is the first extent
+	return ((Record - 1) / RecordsPerSector) + (Schema ? 1 : 0);
+	
+}
+
+uint32_t TeensyDB::extentSector(uint32_t Extent){
+	
+	uint8_t Dir[64];
+	uint32_t Sector = 0;
+	uint32_t Skip = 0;
+	uint32_t Chunk = 0;
+	uint32_t i = 0;
+	
+	if (Extent >= Extents){
+		return TEENSYDB_NOBLOCK;
+	}
+	
+	if (Extent == ExtentCached){
+		return ExtentSector;
+	}
+	
+	// reading on from the last one is usually shorter than from the index
+	if ((ExtentCached != TEENSYDB_NOBLOCK) && (Extent > ExtentCached) && ((Extent - ExtentCached) <= (Extent % ExtentStride))){
+		Sector = ExtentSector;
+		Skip = Extent - ExtentCached;
+	}
+	else {
+		Sector = ExtentIndex[Extent / ExtentStride];
+		Skip = Extent % ExtentStride;
+	}
+	
+	// count our sectors in the directory
+	while (Skip > 0){
+		
+		Sector++;
+		Chunk = DataSectors - Sector;
+		if (Chunk > sizeof(Dir)){
+			Chunk = sizeof(Dir);
+		}
+		if (Chunk == 0){
+			return TEENSYDB_NOBLOCK;
+		}
+		
+		readBytes(Sector, Dir, Chunk);
+		
+		for (i = 0; i < Chunk; i++){
+			if ((Dir[i] == Table) && (--Skip == 0)){
+				break;
+			}
+		}
+		
+		Sector = Sector + ((i < Chunk) ? i : (Chunk - 1));
+	}
+	
+	ExtentCached = Extent;
+	ExtentSector = Sector;
+	
+	return Sector;
+	
+}
+
+uint32_t TeensyDB::findTableEnd(){
+	
+	uint32_t Owned = 0;
+	uint32_t Record = 1;
+	
+	// records in the sectors the table has, the next one after them reads as empty
+	if (Extents > (Schema ? 1 : 0)){
+		Owned = (Extents - (Schema ? 1 : 0)) * RecordsPerSector;
+		Record = findEmptyAfter(1, Owned);
+	}
+	
+	if (Record <= 1){
+		NewCard = true;
+		CurrentRecord = 0;
+		LastRecord = 0;
+		ReadComplete = true;
+		return CHIP_NEW;
+	}
+	
+	NewCard = false;
+	LastRecord = Record - 1;
+	CurrentRecord = LastRecord;
+	gotoRecord(CurrentRecord);
+	ReadComplete = true;
+	
+	return LastRecord;
+	
+}
+
+uint32_t TeensyDB::findFirstWritableRecord(){
+	
+	uint32_t Result = 0;
+	TEENSYDB_STAT(uint32_t Start = micros());
+	
+	if (Table > 0){
+		loadExtents();
+	}
+	
+	// a chip written with another field list can't be read or added to
+	SchemaBad = false;
+	if (Schema && (RecordLength > 0) && (!ReadOnly) && (!checkSchema())){
+		SchemaBad = true;
+		ReadComplete = false;
+		TEENSYDB_STAT(addLatency(LATENCY_FIND, Start));
+		return SCHEMA_MISMATCH;
+	}
+	
+	Result = findEnd();
+	
+	// the erase ahead only lives in RAM, if the power went before it finished nothing would start it again
+	if (RingMode && (LastRecord > 0) && (!ReadOnly)){
+		checkRingAhead();
+	}
+	
+	// the last record is the only one a power loss could have cut off, an erased record was never written, it's not bad
+	BadRecords = 0;
+	if ((CheckLength > 0) && (LastRecord > 0) && (Result == LastRecord)){
+		readRecords(LastRecord, SCANBUF[0], 1);
+		if ((!checkRecord(SCANBUF[0])) && (!isErased(SCANBUF[0], RecordLength))){
+			BadRecords++;
+		}
+	}
+	
+	TEENSYDB_STAT(addLatency(LATENCY_FIND, Start));
+	
+	return Result;
+	
+}
+
+uint32_t TeensyDB::findEnd(){
+	
+	
+	bool Empty = false;
+	uint32_t StartRecord = 0;
+	uint32_t MiddleRecord = 0;
+	uint32_t EndRecord = 0;
+	bool Found = false;
+	bool NextEmpty = false;
+	uint32_t Iteration = 0;
+	uint32_t MaxIteration = 0;
+	uint32_t Record = 0;
+
+
+	// we must have some defined fields in order to compute record length
+	if (RecordLength == 0) {
+		// no fields
+		NewCard = false;
+		CurrentRecord = 0;
+		LastRecord = 0;
+		ReadComplete = false;
+		return NO_FIELDS;
+	}
+	
+	if (Compress){
+		return findPackedEnd();
+	}
+
+	// find the maximum iterations to prevent runaway in cases where the chip was not properly erased
+	// or only portions were erased--leaving gaps in data
+	// such case will not let us find the first writabel record
+	// to elimitate round off errors, add 1 more iteration
+	MaxIteration = (log(Chip->Capacity) / log(2)) + 1;
+
+	// get maximum possible records
+	findMaxRecords();
+	
+	if (Table > 0){
+		return findTableEnd();
+	}
+	
+	// checkpoint first, the end of the data is at most a checkpoint interval (plus what was
+	// in the write queue) past the last checkpoint
+	if (CheckpointInterval > 0){
+		
+		readCheckpoint();
+		
+		if ((CheckpointRecord == 0) || ((CheckpointRecord <= MaxRecords) && (!isRecordEmpty(CheckpointRecord)))){
+			
+			Record = findEmptyAfter(CheckpointRecord + 1, checkpointWindow());
+			
+			if (Record == 1){
+				NewCard = true;
+				CurrentRecord = 0;
+				LastRecord = 0;
+				ReadComplete = true;
+				return CHIP_NEW;
+			}
+			if (Record > MaxRecords){
+				NewCard = false;
+				CurrentRecord = MaxRecords;
+				LastRecord = MaxRecords;
+				ReadComplete = true;
+				return CHIP_FULL;
+			}
+			if (Record > 0){
+				NewCard = false;
+				LastRecord = Record - 1;
+				CurrentRecord = LastRecord;
+				gotoRecord(CurrentRecord);
+				ReadComplete = true;
+				return LastRecord;
+			}
+		}
+		
+		// checkpoint does not match the data, search the whole chip
+		if (RingMode){
+			return findRingEnd();
+		}
+	}
+	
+	// test the first record
+	if (isRecordEmpty(1)){
+		// no DATA
+		NewCard = true;
+		CurrentRecord = 0;
+		LastRecord = 0;
+		ReadComplete = true;
+		return CHIP_NEW;
+	}
+	
+	// test the last record
+	if (!isRecordEmpty(MaxRecords)){
+		// card full
+		NewCard = false;
+		CurrentRecord = MaxRecords;
+		LastRecord = MaxRecords;
+		ReadComplete = true;
+		return CHIP_FULL;
+	}
+	/*
+	// record crawling scheme, slow
+	for (i = 1; i < MaxRecords; i++){
+		if (isRecordEmpty(i)){
+			NewCard = false;
+			LastRecord = i;
+			ReadComplete = true;
+			return LastRecord;
+		}
+		
+	}
+	*/
+	
+	// much faster alternative to finding the first writable record
+	// begin the bisectional seek to get the last valid record 
+	// (where record start address is not 0xFFFF and next record IS 0xFFFF)
+	StartRecord = 1;
+	EndRecord = MaxRecords;
+		
+	// OK last record is somewhere in between...
+	while(!Found) {
+		
+		Iteration++;
+		
+		MiddleRecord = (EndRecord + StartRecord) / 2;
+		Empty = isRecordEmpty(MiddleRecord);
+		NextEmpty = isRecordEmpty(MiddleRecord + 1);
+	
+		if (Empty && NextEmpty){
+			// first writabel record must be before middle record
+			EndRecord = MiddleRecord;
+		}
+		if ((!Empty) && (!NextEmpty)){
+			// first writabel record must be after middle record
+			StartRecord = MiddleRecord;
+		}
+		if ((!Empty) && NextEmpty){
+			// we found first writabel record
+			LastRecord = MiddleRecord;
+			Found = true;
+		}
+		if (Empty && (!NextEmpty)){
+			// properly erased chip, this case should never be encountered
+			// this means record 1 is NULL and next record has data
+			// consider the chip full
+			NewCard = false;
+			CurrentRecord = MaxRecords;
+			LastRecord = MaxRecords;
+			ReadComplete = true;
+			getAddress();
+			return LastRecord;
+		}
+		
+		if (Iteration > MaxIteration) {
+			// this should never happen, but if the card was not fully erased where
+			// there are gaps in used space, we may never find the first writabel record
+			NewCard = true;
+			MiddleRecord = 0;
+			CurrentRecord = 0;
+			LastRecord = 0;
+			ReadComplete = true;
+			getAddress();
+			return CHIP_FORCE_RESTART;
+		}
+			
+	}
+	
+	
+	NewCard = false;
+	LastRecord = MiddleRecord;
+	CurrentRecord = MiddleRecord;
+	getAddress();
+	ReadComplete = true;
+	
+	return LastRecord;
+	
+}
+
+/*
+
+checkpoints, the first 2 sectors of the chip (after the schema sector, if used) hold a log of 8 byte entries (record number, then its inverse so a
+torn or partial entry can be spotted). entries are appended to one sector until it's full, then the other sector is
+erased and used, so a checkpoint never needs an erase of its own and the newest entry always survives in one of them.
+an entry is written at most every CheckpointInterval records and only for records that are already on the chip.
+
+at boot the last used slot of each sector is found with a short bisection (slots are used in order), the newest valid
+entry wins and findFirstWritableRecord reads forward from there
+
+*/
+
+void TeensyDB::setCheckpoint(uint16_t Interval){
+	
+	// a table finds its end from the directory
+	if (Table > 0){
+		Interval = 0;
+	}
+	
+	CheckpointInterval = Interval;
+	
+	// ring mode can't find its write head without checkpoints
+	if (CheckpointInterval == 0){
+		RingMode = false;
+	}
+	
+	if (CheckpointInterval > 0){
+		DataStart = MetaStart + (2 * Chip->SectorSize);
+	}
+	else {
+		DataStart = MetaStart;
+	}
+	
+	CheckpointRecord = 0;
+	CheckpointSector = 0;
+	CheckpointSlot = 0;
+	RecordCached = false;
+	
+	if (RecordLength > 0) {
+		findMaxRecords();
+	}
+	
+}
+
+bool TeensyDB::checkpoint(){
+	
+	if (CheckpointInterval == 0){
+		return false;
+	}
+	
+	flush();
+	updateCheckpoint(true);
+	
+	return true;
+	
+}
+
+uint32_t TeensyDB::getCheckpointRecord(){
+	
+	return CheckpointRecord;
+	
+}
+
+uint32_t TeensyDB::checkpointInterval(){
+	
+	uint32_t Interval = CheckpointInterval;
+	
+	// ring mode, keep the write head within a sector of the checkpoint so the boot search
+	// never runs into old data past the erased sector
+	if (RingMode && (Interval > (RecordsPerSector / 2))){
+		Interval = RecordsPerSector / 2;
+	}
+	if (Interval == 0){
+		Interval = 1;
+	}
+	
+	return Interval;
+	
+}
+
+uint32_t TeensyDB::checkpointWindow(){
+	
+	// how far past the checkpoint the end of the data can be: the interval plus whatever was in the write queue
+	uint32_t Window = checkpointInterval() + (TEENSYDB_WRITEQUEUE / RecordLength) + 2;
+	
+	if (RingMode && (Window > RecordsPerSector)){
+		Window = RecordsPerSector;
+	}
+	
+	return Window;
+	
+}
+
+void TeensyDB::updateCheckpoint(bool Force){
+	
+	uint32_t Committed = 0;
+	uint32_t Queued = 0;
+	
+	if ((CheckpointInterval == 0) || (RecordLength == 0)){
+		return;
+	}
+	
+	// the queue holds the records up to QueuedRecord, a record that is partly programmed still counts as queued
+	Queued = (WQCount + RecordLength - 1) / RecordLength;
+	
+	if (QueuedRecord <= Queued){
+		return;
+	}
+	
+	Committed = QueuedRecord - Queued;
+	
+	if (Committed <= CheckpointRecord){
+		return;
+	}
+	
+	if ((!Force) && ((Committed - CheckpointRecord) < checkpointInterval())){
+		return;
+	}
+	
+	writeCheckpoint(Committed);
+	
+}
+
+void TeensyDB::writeCheckpoint(uint32_t Record){
+	
+	uint8_t Entry[8];
+	
+	B4ToBytes(Entry, Record);
+	B4ToBytes(&Entry[4], (uint32_t) ~Record);
+	
+	// this sector is full, start over in the other one
+	if (CheckpointSlot >= Chip->SectorSize){
+		CheckpointSector = CheckpointSector ^ 1;
+		CheckpointSlot = 0;
+		finishErase();
+		Device->erase(ERASE_SECTOR, MetaStart + (CheckpointSector * Chip->SectorSize));
+		TEENSYDB_STAT(Stats.Erases++);
+		waitForChip(Chip->SectorEraseTime, LATENCY_ERASE);
+	}
+	
+	readyFor(MetaStart + (CheckpointSector * Chip->SectorSize) + CheckpointSlot, 8, true);
+	Device->program(MetaStart + (CheckpointSector * Chip->SectorSize) + CheckpointSlot, Entry, 8);
+	TEENSYDB_STAT(Stats.Programs++);
+	TEENSYDB_STAT(Stats.ProgramBytes += 8);
+	waitForChip(Chip->ProgramTime, LATENCY_PROGRAM);
+	
+	CheckpointSlot = CheckpointSlot + 8;
+	CheckpointRecord = Record;
+	
+}
+
+void TeensyDB::readCheckpoint(){
+	
+	uint8_t Sector = 0;
+	uint32_t First = 0;
+	uint32_t Last = 0;
+	uint32_t Middle = 0;
+	uint32_t Slot = 0;
+	uint32_t Record = 0;
+	uint32_t Inverse = 0;
+	uint32_t NextSlot[2];
+	uint8_t Entry[8];
+	uint8_t Tries = 0;
+	uint32_t Slots = Chip->SectorSize / 8;
+	
+	CheckpointRecord = 0;
+	CheckpointSector = 0;
+	
+	for (Sector = 0; Sector < 2; Sector++){
+		
+		// find the first empty slot, used slots are always at the start of the sector
+		First = 0;
+		Last = Slots;
+		while (First < Last){
+			Middle = (First + Last) / 2;
+			readBytes(MetaStart + (Sector * Chip->SectorSize) + (Middle * 8), Entry, 8);
+			if (isErased(Entry, 8)){
+				Last = Middle;
+			}
+			else {
+				First = Middle + 1;
+			}
+		}
+		
+		NextSlot[Sector] = First * 8;
+		
+		// newest valid entry, a torn write at the end fails the inverse check so step back a few
+		for (Tries = 0, Slot = First; (Slot > 0) && (Tries < 4); Tries++, Slot--){
+			
+			readBytes(MetaStart + (Sector * Chip->SectorSize) + ((Slot - 1) * 8), Entry, 8);
+			
+			Record = ((uint32_t) Entry[0] << 24) | ((uint32_t) Entry[1] << 16) | ((uint32_t) Entry[2] << 8) | Entry[3];
+			Inverse = ((uint32_t) Entry[4] << 24) | ((uint32_t) Entry[5] << 16) | ((uint32_t) Entry[6] << 8) | Entry[7];
+			
+			if ((Record ^ Inverse) == 0xFFFFFFFF){
+				if (Record > CheckpointRecord){
+					CheckpointRecord = Record;
+					CheckpointSector = Sector;
+				}
+				break;
+			}
+		}
+	}
+	
+	// carry on after the newest entry (or at the start of sector 0 if there isn't one)
+	CheckpointSlot = NextSlot[CheckpointSector];
+	
+}
+
+bool TeensyDB::isErased(const uint8_t *Data, uint32_t Length){
+	
+	uint32_t k = 0;
+	
+	for (k = 0; k < Length; k++){
+		if (Data[k] != NULL_RECORD){
+			return false;
+		}
+	}
+	
+	return true;
+	
+}
+
+bool TeensyDB::isRecordEmpty(uint32_t Record){
+	
+	// a table record past the sectors the table has
+	if ((Table > 0) && (Record > 0) && (extentSector(recordExtent(Record)) == TEENSYDB_NOBLOCK)){
+		return true;
+	}
+	
+	readBytes(recordAddress(Record), SCANBUF[0], RecordLength);
+	
+	return isErased(SCANBUF[0], RecordLength);
+	
+}
+
+uint32_t TeensyDB::findEmptyAfter(uint32_t StartRecord, uint32_t Limit){
+	
+	uint32_t First = StartRecord;
+	uint32_t Last = StartRecord + Limit;
+	uint32_t Middle = 0;
+	
+	if (Last > (MaxRecords + 1)){
+		Last = MaxRecords + 1;
+	}
+	
+	// the window has to end in erased space, otherwise there's more data than the checkpoint knows about
+	if ((Last <= MaxRecords) && (!isRecordEmpty(Last))){
+		return 0;
+	}
+	
+	// written records then erased ones, bisect for the first erased one (MaxRecords + 1 if the chip is full)
+	while (First < Last){
+		Middle = (First + Last) / 2;
+		if (isRecordEmpty(Middle)){
+			Last = Middle;
+		}
+		else {
+			First = Middle + 1;
+		}
+	}
+	
+	return First;
+	
+}
+
+/*
+
+ring mode, when the chip is full logging carries on over the oldest data instead of stopping. records are packed
+into sectors (a record never spans two sectors, the few bytes left at the end of a sector are not used) and record
+numbers keep counting up, record r lives in sector ((r - 1) / RecordsPerSector) modulo the number of data sectors.
+
+when the first record of a sector is saved, the erase of the next sector is scheduled. it runs in the background ahead of
+the next page program (saveRecordAsync / poll) so there is always a clean sector in front of the write head, which
+bounds the latency of a save to one sector erase and is also the marker that separates the newest data from the oldest.
+the write head is found at boot from the checkpoints, so ring mode turns them on. the scheduled erase is only in RAM,
+so at boot the sector in front of the head is checked and erased again if a power loss cut its erase short
+
+*/
+
+void TeensyDB::setRingMode(bool Enable){
+	
+	RingMode = Enable;
+	
+	if (RingMode && (CheckpointInterval == 0)){
+		setCheckpoint(TEENSYDB_RINGCHECKPOINT);
+	}
+	
+	if (RecordLength > 0) {
+		findMaxRecords();
+	}
+	
+}
+
+uint32_t TeensyDB::getFirstRecord(){
+	
+	uint32_t Head = 0;
+	
+	if ((!RingMode) || (LastRecord == 0)){
+		return 1;
+	}
+	
+	// the sector after the head is erased, the DataSectors - 1 sectors up to the head have data
+	Head = (LastRecord - 1) / RecordsPerSector;
+	
+	if ((Head + 2) <= DataSectors){
+		return 1;
+	}
+	
+	return ((Head + 2 - DataSectors) * RecordsPerSector) + 1;
+	
+}
+
+uint32_t TeensyDB::chunkRecords(uint32_t Record, uint32_t EndRecord){
+	
+	uint32_t Chunk = EndRecord - Record + 1;
+	
+	if (Chunk > (TEENSYDB_SCANBUFFER / RecordLength)){
+		Chunk = TEENSYDB_SCANBUFFER / RecordLength;
+	}
+	
+	// packed into sectors, the next sector may be anywhere (ring mode) or there's a zone map in the way
+	if ((RecordsPerSector > 0) && (Record > 0) && (Chunk > (RecordsPerSector - ((Record - 1) % RecordsPerSector)))){
+		Chunk = RecordsPerSector - ((Record - 1) % RecordsPerSector);
+	}
+	
+	return Chunk;
+	
+}
+
+/*
+
+zone maps, with setZoneMap(true) records are packed into sectors like ring mode and the space after the last record
+of a sector holds a summary of it, the min and max of every numeric field. the summary is kept in RAM as records are
+saved and goes into the write queue right behind the sector's last record, so it costs a few bytes of the page program
+that was happening anyway. it's erased with its sector so ring mode can use it too.
+
+scanWhere reads the summary of each full sector first and skips the sector when the field's range can't match. the
+sector being written (and any sector whose summary is missing) is always read. the sector number is written last
+and checked against its inverse, so a summary that was cut off by a power loss is never trusted
+
+*/
+
+bool TeensyDB::setZoneMap(bool Enable){
+	
+	// the chip must be written with the same setting it's read with
+	ZoneMap = Enable;
+	RecordCached = false;
+	
+	if (RecordLength > 0) {
+		findMaxRecords();
+	}
+	
+	return (!Enable) || (ZoneMap && (RecordsPerSector > 0));
+	
+}
+
+uint32_t TeensyDB::scanWhere(uint8_t Field, double Low, double High, TeensyDBScanCallback Callback, bool Prefetch){
+	
+	uint32_t Record = 0;
+	uint32_t EndRecord = 0;
+	uint32_t Count = 0;
+	
+	if ((Field < 1) || (Field > FieldCount) || (DataType[Field] == DT_CHAR) || (LastRecord == 0)){
+		return 0;
+	}
+	
+	WhereField = Field;
+	WhereLow = Low;
+	WhereHigh = High;
+	ScanStopped = false;
+	
+	if (!ZoneMap){
+		Count = scan(getFirstRecord(), LastRecord, Callback, Prefetch);
+		WhereField = 0;
+		return Count;
+	}
+	
+	// a sector at a time, the sector is only read if its summary says it may match
+	Record = getFirstRecord();
+	
+	while ((Record <= LastRecord) && (!ScanStopped)){
+		
+		EndRecord = (((Record - 1) / RecordsPerSector) + 1) * RecordsPerSector;
+		
+		if (EndRecord > LastRecord){
+			EndRecord = LastRecord;
+		}
+		else if (!zoneMatch(Record, Field, Low, High)){
+			Record = EndRecord + 1;
+			continue;
+		}
+		
+		Count = Count + scan(Record, EndRecord, Callback, Prefetch);
+		Record = EndRecord + 1;
+	}
+	
+	WhereField = 0;
+	
+	return Count;
+	
+}
+
+bool TeensyDB::zoneMatch(uint32_t Record, uint8_t Field, double Low, double High){
+	
+	uint32_t Sector = (Record - 1) / RecordsPerSector;
+	uint32_t ZoneAddress = recordAddress((Sector * RecordsPerSector) + 1) + (RecordsPerSector * RecordLength);
+	uint16_t Length = ZoneLength - ZoneSlot[Field];
+	uint8_t *Zone = SCANBUF[0];
+	double Min = 0;
+	double Max = 0;
+	
+	// one read from this field's min to the end of the summary
+	readBytes(ZoneAddress + ZoneSlot[Field], Zone, Length);
+	
+	// no summary (or a torn one), the sector has to be read
+	if ((BytesToB4(&Zone[Length - 8]) != Sector) || (BytesToB4(&Zone[Length - 4]) != (uint32_t) ~Sector)){
+		return true;
+	}
+	
+	memcpy(&Min, &Zone[0], 8);
+	memcpy(&Max, &Zone[8], 8);
+	
+	return (Max >= Low) && (Min <= High);
+	
+}
+
+void TeensyDB::addZone(const uint8_t *Bytes){
+	
+	uint8_t i = 0;
+	double Value = 0;
+	
+	for (i = 1; i <= FieldCount; i++){
+		
+		if (DataType[i] == DT_CHAR){
+			continue;
+		}
+		
+		Value = fieldValue(Bytes, i);
+		
+		if (Value < ZoneMin[i]){
+			ZoneMin[i] = Value;
+		}
+		if (Value > ZoneMax[i]){
+			ZoneMax[i] = Value;
+		}
+	}
+	
+}
+
+void TeensyDB::loadZone(uint32_t Record){
+	
+	uint32_t Start = (((Record - 1) / RecordsPerSector) * RecordsPerSector) + 1;
+	uint32_t Chunk = 0;
+	uint32_t r = 0;
+	uint8_t i = 0;
+	
+	for (i = 1; i <= FieldCount; i++){
+		ZoneMin[i] = INFINITY;
+		ZoneMax[i] = -INFINITY;
+	}
+	
+	ZoneSector = (Record - 1) / RecordsPerSector;
+	ZoneLoaded = true;
+	
+	// after a reboot or a gotoRecord the records already in this sector have to be counted in
+	while (Start < Record){
+		
+		Chunk = chunkRecords(Start, Record - 1);
+		readRecords(Start, SCANBUF[0], Chunk);
+		
+		for (r = 0; r < Chunk; r++){
+			addZone(&SCANBUF[0][r * RecordLength]);
+		}
+		
+		Start = Start + Chunk;
+	}
+	
+}
+
+void TeensyDB::queueZone(){
+	
+	uint8_t Zone[(MAX_FIELDS * 16) + 8];
+	uint8_t i = 0;
+	uint16_t Tail = (WQHead + WQCount) % TEENSYDB_WRITEQUEUE;
+	uint16_t q = 0;
+	
+	// build the summary first, the queue may wrap
+	for (i = 1; i <= FieldCount; i++){
+		if (DataType[i] != DT_CHAR){
+			DoubleToBytes(&Zone[ZoneSlot[i]], ZoneMin[i]);
+			DoubleToBytes(&Zone[ZoneSlot[i] + 8], ZoneMax[i]);
+		}
+	}
+	B4ToBytes(&Zone[ZoneLength - 8], ZoneSector);
+	B4ToBytes(&Zone[ZoneLength - 4], (uint32_t) ~ZoneSector);
+	
+	for (q = 0; q < ZoneLength; q++){
+		WQUEUE[Tail] = Zone[q];
+		Tail++;
+		if (Tail >= TEENSYDB_WRITEQUEUE){
+			Tail = 0;
+		}
+	}
+	
+	WQCount = WQCount + ZoneLength;
+	ZoneLoaded = false;
+	
+}
+
+double TeensyDB::fieldValue(const uint8_t *Bytes, uint8_t Field){
+	
+	float f = 0;
+	double d = 0;
+	
+	if (DataType[Field] == DT_SCALED){
+		return FieldOffset[Field] + (getBits(Bytes, Field) * (double) FieldScale[Field]);
+	}
+	if (isBitField(Field)){
+		return getBits(Bytes, Field);
+	}
+	
+	Bytes = &Bytes[FieldStart[Field]];
+	
+	// the same encoding as saveRecord
+	switch (DataType[Field]){
+		case DT_U8:
+			return Bytes[0];
+		case DT_I16:
+			return (int16_t) ((Bytes[0] << 8) | Bytes[1]);
+		case DT_U16:
+			return (uint16_t) ((Bytes[0] << 8) | Bytes[1]);
+		case DT_INT:
+		case DT_I32:
+			return (int32_t) BytesToB4(Bytes);
+		case DT_U32:
+			return BytesToB4(Bytes);
+		case DT_FLOAT:
+			memcpy(&f, Bytes, 4);
+			return f;
+		case DT_DOUBLE:
+			memcpy(&d, Bytes, 8);
+			return d;
+	}
+	
+	return 0;
+	
+}
+
+/*
+
+compressed storage, with setCompression(true) a record is stored as the difference from the record before it. whole
+numbers are stored as a zig zag varint of the change (a slowly moving reading is 1 byte), floats and doubles as the XOR
+with the previous value with the zero bytes at either end dropped (the Gorilla idea at byte level, an unchanged value is
+1 byte) and char fields as one byte when they did not change.
+
+the data area is cut into page sized blocks: the number of the first record in the block, then [length][packed record]
+entries until the next one won't fit, the rest of the page stays erased. the first record of a block is packed against
+a record of zeros so every block can be decoded on its own, finding a record is a bisection on the block headers
+(narrowed by a small index in RAM) and one page read. entries go through the write queue like normal records, the end of
+a page is padded with 0xFF (programming 0xFF changes nothing) so a page still goes out in one program.
+checkpoints, ring mode and zone maps need records at fixed addresses so they can't be used with it
+
+*/
+
+bool TeensyDB::setCompression(bool Enable){
+	
+	// tables are not compressed
+	if (Table > 0){
+		return !Enable;
+	}
+	
+	flush();
+	
+	Compress = Enable;
+	
+	if (Compress){
+		ZoneMap = false;
+		setCheckpoint(0);
+	}
+	
+	RecordCached = false;
+	
+	if (RecordLength > 0) {
+		findMaxRecords();
+	}
+	
+	// an entry has to fit in a block with its header
+	return (!Compress) || ((5 + RecordLength + (2 * FieldCount)) <= Chip->PageSize);
+	
+}
+
+uint16_t TeensyDB::packRecord(const uint8_t *Prev, uint8_t *Entry){
+	
+	uint16_t Length = 1;
+	uint8_t f = 0;
+	uint8_t k = 0;
+	uint8_t n = 0;
+	uint8_t Lo = 0;
+	uint8_t Hi = 0;
+	uint8_t Width = 0;
+	uint32_t Value = 0;
+	uint32_t Last = 0;
+	int32_t Delta = 0;
+	uint8_t Diff[8];
+	const uint8_t *Bytes;
+	
+	for (f = 1; f <= FieldCount; f++){
+		
+		Bytes = &RECORD[FieldStart[f]];
+		n = FieldLength[f];
+		
+		if (isBitField(f)){
+			
+			// bit fields share bytes, the change in each one's own bits
+			Value = getBits(RECORD, f);
+			Last = getBits(Prev, f);
+			Width = FieldBits[f];
+		}
+		else if ((DataType[f] == DT_FLOAT) || (DataType[f] == DT_DOUBLE)){
+			
+			// XOR with the last value, keep only the bytes between the zero bytes at each end
+			for (k = 0; k < n; k++){
+				Diff[k] = Bytes[k] ^ Prev[FieldStart[f] + k];
+			}
+			for (Lo = 0; (Lo < n) && (Diff[Lo] == 0); Lo++){
+			}
+			if (Lo == n){
+				Entry[Length++] = 0;
+				continue;
+			}
+			for (Hi = 0; Diff[n - 1 - Hi] == 0; Hi++){
+			}
+			Entry[Length++] = (Lo << 4) | (n - Lo - Hi);
+			for (k = Lo; k < (n - Hi); k++){
+				Entry[Length++] = Diff[k];
+			}
+		}
+		else if (DataType[f] == DT_CHAR){
+			
+			if (memcmp(Bytes, &Prev[FieldStart[f]], n) == 0){
+				Entry[Length++] = 0;
+				continue;
+			}
+			Entry[Length++] = 1;
+			memcpy(&Entry[Length], Bytes, n);
+			Length = Length + n;
+		}
+		else {
+			
+			// the change in the big endian value, sign extended from the field width so -1 is small
+			Value = 0;
+			Last = 0;
+			for (k = 0; k < n; k++){
+				Value = (Value << 8) | Bytes[k];
+				Last = (Last << 8) | Prev[FieldStart[f] + k];
+			}
+			Width = 8 * n;
+		}
+		
+		if ((DataType[f] != DT_FLOAT) && (DataType[f] != DT_DOUBLE) && (DataType[f] != DT_CHAR)){
+			
+			Delta = (int32_t) ((Value - Last) << (32 - Width)) >> (32 - Width);
+			
+			// zig zag then 7 bits at a time
+			Value = ((uint32_t) Delta << 1) ^ (uint32_t) (Delta >> 31);
+			while (Value >= 0x80){
+				Entry[Length++] = (uint8_t) (Value | 0x80);
+				Value = Value >> 7;
+			}
+			Entry[Length++] = (uint8_t) Value;
+		}
+	}
+	
+	// the record check changes every record, it goes in as it is
+	memcpy(&Entry[Length], &RECORD[CheckStart], CheckLength);
+	Length = Length + CheckLength;
+	
+	// entry length first, never 0xFF so an erased byte marks the end of a block
+	Entry[0] = (uint8_t) (Length - 1);
+	
+	return Length;
+	
+}
+
+uint16_t TeensyDB::unpackRecord(const uint8_t *Entry, uint8_t *Prev){
+	
+	uint16_t Length = 1;
+	uint8_t f = 0;
+	uint8_t k = 0;
+	uint8_t n = 0;
+	uint8_t Lo = 0;
+	uint8_t Shift = 0;
+	uint32_t Value = 0;
+	uint32_t Last = 0;
+	int32_t Delta = 0;
+	uint8_t *Bytes;
+	
+	// the record is rebuilt on top of the one before it
+	for (f = 1; f <= FieldCount; f++){
+		
+		Bytes = &Prev[FieldStart[f]];
+		n = FieldLength[f];
+		
+		if ((DataType[f] == DT_FLOAT) || (DataType[f] == DT_DOUBLE)){
+			
+			Lo = Entry[Length] >> 4;
+			k = Entry[Length++] & 0x0F;
+			while (k > 0){
+				Bytes[Lo++] ^= Entry[Length++];
+				k--;
+			}
+		}
+		else if (DataType[f] == DT_CHAR){
+			
+			if (Entry[Length++] != 0){
+				memcpy(Bytes, &Entry[Length], n);
+				Length = Length + n;
+			}
+		}
+		else {
+			
+			Value = 0;
+			Shift = 0;
+			do {
+				Value = Value | ((uint32_t) (Entry[Length] & 0x7F) << Shift);
+				Shift = Shift + 7;
+			} while (Entry[Length++] & 0x80);
+			Delta = (int32_t) (Value >> 1) ^ -(int32_t) (Value & 1);
+			
+			if (isBitField(f)){
+				putBits(Prev, f, getBits(Prev, f) + (uint32_t) Delta);
+				continue;
+			}
+			
+			Last = 0;
+			for (k = 0; k < n; k++){
+				Last = (Last << 8) | Bytes[k];
+			}
+			Value = Last + (uint32_t) Delta;
+			for (k = n; k > 0; k--){
+				Bytes[k - 1] = (uint8_t) Value;
+				Value = Value >> 8;
+			}
+		}
+	}
+	
+	memcpy(&Prev[CheckStart], &Entry[Length], CheckLength);
+	Length = Length + CheckLength;
+	
+	return Length;
+	
+}
+
+uint32_t TeensyDB::blockFirst(uint32_t Block){
+	
+	uint8_t Header[4];
+	
+	// the index holds every BlockStride'th header
+	if (((Block % BlockStride) == 0) && (BlockIndex[Block / BlockStride] != 0)){
+		return BlockIndex[Block / BlockStride];
+	}
+	
+	readBytes(DataStart + (Block * Chip->PageSize), Header, 4);
+	
+	if (isErased(Header, 4)){
+		return 0;
+	}
+	
+	if ((Block % BlockStride) == 0){
+		BlockIndex[Block / BlockStride] = BytesToB4(Header);
+	}
+	
+	return BytesToB4(Header);
+	
+}
+
+uint32_t TeensyDB::findBlock(uint32_t Record){
+	
+	uint32_t LastBlock = (CompAddress - DataStart - 1) / Chip->PageSize;
+	uint32_t First = 0;
+	uint32_t Last = LastBlock / BlockStride;
+	uint32_t Middle = 0;
+	
+	// last block with a first record <= Record, the index entries first then the blocks between two of them
+	while (First < Last){
+		Middle = (First + Last + 1) / 2;
+		if (blockFirst(Middle * BlockStride) <= Record){
+			First = Middle;
+		}
+		else {
+			Last = Middle - 1;
+		}
+	}
+	
+	First = First * BlockStride;
+	Last = First + BlockStride - 1;
+	if (Last > LastBlock){
+		Last = LastBlock;
+	}
+	
+	while (First < Last){
+		Middle = (First + Last + 1) / 2;
+		if (blockFirst(Middle) <= Record){
+			First = Middle;
+		}
+		else {
+			Last = Middle - 1;
+		}
+	}
+	
+	return First;
+	
+}
+
+bool TeensyDB::openBlock(uint32_t Block){
+	
+	DecBlock = TEENSYDB_NOBLOCK;
+	
+	if ((DataStart + ((Block + 1) * Chip->PageSize)) > Chip->Capacity){
+		return false;
+	}
+	
+	readBytes(DataStart + (Block * Chip->PageSize), CBUF, Chip->PageSize);
+	
+	if (isErased(CBUF, 4)){
+		return false;
+	}
+	
+	DecBlock = Block;
+	DecRecord = BytesToB4(CBUF);
+	DecPos = 4;
+	memset(DecPrev, 0, RecordLength);
+	
+	return true;
+	
+}
+
+bool TeensyDB::readPacked(uint32_t Record, uint8_t *Buffer){
+	
+	// carry on from the last record read if it's in this block or the next, otherwise find its block
+	if ((DecBlock == TEENSYDB_NOBLOCK) || (Record < DecRecord) || ((Record - DecRecord) > (uint32_t) (Chip->PageSize / 2))){
+		if ((CompAddress == DataStart) || (!openBlock(findBlock(Record)))){
+			memset(Buffer, NULL_RECORD, RecordLength);
+			return false;
+		}
+	}
+	
+	while (true){
+		
+		// end of this block, on to the next
+		if ((DecPos >= Chip->PageSize) || (CBUF[DecPos] == NULL_RECORD)){
+			if (!openBlock(DecBlock + 1)){
+				memset(Buffer, NULL_RECORD, RecordLength);
+				return false;
+			}
+		}
+		
+		if (DecRecord > Record){
+			// before the first record of the block, can only be a record that was never written
+			memset(Buffer, NULL_RECORD, RecordLength);
+			return false;
+		}
+		
+		DecPos = DecPos + unpackRecord(&CBUF[DecPos], DecPrev);
+		DecRecord++;
+		
+		if ((DecRecord - 1) == Record){
+			memcpy(Buffer, DecPrev, RecordLength);
+			return true;
+		}
+	}
+	
+}
+
+void TeensyDB::readRecords(uint32_t Record, uint8_t *Buffer, uint32_t Count, bool Wait){
+	
+	uint32_t r = 0;
+	
+	if (!Compress){
+		readBytes(recordAddress(Record), Buffer, Count * RecordLength, Wait);
+		return;
+	}
+	
+	for (r = 0; r < Count; r++){
+		readPacked(Record + r, &Buffer[r * RecordLength]);
+	}
+	
+}
+
+uint32_t TeensyDB::findPackedEnd(){
+	
+	uint32_t First = 0;
+	uint32_t Last = (Chip->Capacity - DataStart) / Chip->PageSize;
+	uint32_t Middle = 0;
+	
+	// first block that was never started
+	while (First < Last){
+		Middle = (First + Last) / 2;
+		if (blockFirst(Middle) == 0){
+			Last = Middle;
+		}
+		else {
+			First = Middle + 1;
+		}
+	}
+	
+	CompAddress = DataStart;
+	memset(CompPrev, 0, RecordLength);
+	LastRecord = 0;
+	
+	// pick up the last block where it ended
+	if ((First > 0) && openBlock(First - 1)){
+		while ((DecPos < Chip->PageSize) && (CBUF[DecPos] != NULL_RECORD)){
+			DecPos = DecPos + unpackRecord(&CBUF[DecPos], DecPrev);
+			DecRecord++;
+		}
+		LastRecord = DecRecord - 1;
+		CompAddress = DataStart + ((First - 1) * Chip->PageSize) + DecPos;
+		memcpy(CompPrev, DecPrev, RecordLength);
+	}
+	
+	CompRecord = LastRecord;
+	DecBlock = TEENSYDB_NOBLOCK;
+	NewCard = (LastRecord == 0);
+	CurrentRecord = LastRecord;
+	ReadComplete = true;
+	
+	return LastRecord;
+	
+}
+
+uint32_t TeensyDB::findRingEnd(){
+	
+	uint32_t Sector = 0;
+	uint32_t Previous = 0;
+	uint32_t Record = 0;
+	
+	// the checkpoint is gone, look for the erased sector in front of the write head
+	// record numbers can't be recovered, they carry on as if this were the first pass over the chip
+	for (Sector = 0; Sector < DataSectors; Sector++){
+		
+		Previous = (Sector + DataSectors - 1) % DataSectors;
+		
+		if (isRecordEmpty((Sector * RecordsPerSector) + 1) && (!isRecordEmpty((Previous * RecordsPerSector) + 1))){
+			Record = findEmptyAfter((Previous * RecordsPerSector) + 1, RecordsPerSector);
+			break;
+		}
+	}
+	
+	// start the checkpoint log over so the old entries can't confuse the next boot
+	finishErase();
+	Device->erase(ERASE_SECTOR, MetaStart);
+	TEENSYDB_STAT(Stats.Erases++);
+	waitForChip(Chip->SectorEraseTime, LATENCY_ERASE);
+	Device->erase(ERASE_SECTOR, MetaStart + Chip->SectorSize);
+	TEENSYDB_STAT(Stats.Erases++);
+	waitForChip(Chip->SectorEraseTime, LATENCY_ERASE);
+	CheckpointRecord = 0;
+	CheckpointSector = 0;
+	CheckpointSlot = 0;
+	RecordCached = false;
+	
+	if (Record <= 1){
+		// nothing found, treat it as new
+		NewCard = true;
+		CurrentRecord = 0;
+		LastRecord = 0;
+		ReadComplete = true;
+		return CHIP_NEW;
+	}
+	
+	NewCard = false;
+	LastRecord = Record - 1;
+	CurrentRecord = LastRecord;
+	gotoRecord(CurrentRecord);
+	ReadComplete = true;
+	
+	writeCheckpoint(LastRecord);
+	
+	return LastRecord;
+	
+}
+
+void TeensyDB::checkRingAhead(){
+	
+	uint32_t Sector = 0;
+	uint32_t Offset = 0;
+	uint32_t Length = 0;
+	bool Erased = true;
+	
+	// the first record of the sector after the head, record numbers wrap onto the chip
+	Sector = recordAddress((((LastRecord - 1) / RecordsPerSector) + 1) * RecordsPerSector + 1);
+	Sector = Sector - (Sector % Chip->SectorSize);
+	
+	for (Offset = 0; Erased && (Offset < Chip->SectorSize); Offset = Offset + Length){
+		Length = Chip->SectorSize - Offset;
+		if (Length > TEENSYDB_SCANBUFFER){
+			Length = TEENSYDB_SCANBUFFER;
+		}
+		readBytes(Sector + Offset, SCANBUF[0], Length);
+		Erased = isErased(SCANBUF[0], Length);
+	}
+	
+	if (Erased){
+		return;
+	}
+	
+	finishErase();
+	Device->erase(ERASE_SECTOR, Sector);
+	TEENSYDB_STAT(Stats.Erases++);
+	waitForChip(Chip->SectorEraseTime, LATENCY_ERASE);
+	RecordCached = false;
+	
+}
+
+void TeensyDB::findMaxRecords(){
+	// get maximum possible records
+	// we back out one record to accomodate a possible partial record
+	// we back out one more since were' not starting at 0 but record 1;
+	
+	uint8_t i = 0;
+	
+	// record addresses may have moved
+	IndexBuilt = false;
+	ZoneLoaded = false;
+	
+	// a bit field gets its bytes after newField, a record of only bit fields has none until then
+	if (RecordLength == 0){
+		RecordsPerSector = 0;
+		MaxRecords = 0;
+		return;
+	}
+	
+	// zone maps, a min and max for each numeric field then the sector number and its inverse
+	ZoneLength = 0;
+	if (ZoneMap){
+		for (i = 1; i <= FieldCount; i++){
+			if (DataType[i] != DT_CHAR){
+				ZoneSlot[i] = ZoneLength;
+				ZoneLength = ZoneLength + 16;
+			}
+		}
+		ZoneLength = ZoneLength + 8;
+		
+		// the zone goes out with the last record of its sector, together they have to fit the write queue
+		if ((RecordLength + ZoneLength) > TEENSYDB_WRITEQUEUE){
+			ZoneMap = false;
+			ZoneLength = 0;
+		}
+	}
+	
+	// records packed into sectors, a record never spans two of them
+	RecordsPerSector = 0;
+	DataSectors = (Chip->Capacity - DataStart) / Chip->SectorSize;
+	if (RingMode || ZoneMap || (Table > 0)){
+		RecordsPerSector = (Chip->SectorSize - ZoneLength) / RecordLength;
+	}
+	
+	if (Compress){
+		// blocks hold as many records as they can, addRecord watches for the end of the chip
+		RecordsPerSector = 0;
+		MaxRecords = 0xFFFFFFFE;
+		BlockStride = (((Chip->Capacity - DataStart) / Chip->PageSize) / TEENSYDB_BLOCKINDEX) + 1;
+		memset(BlockIndex, 0, sizeof(BlockIndex));
+		DecBlock = TEENSYDB_NOBLOCK;
+		return;
+	}
+	
+	if (RingMode){
+		// record numbers keep counting up, the sectors are reused
+		MaxRecords = 0xFFFFFFFE;
+		return;
+	}
+	
+	if (RecordsPerSector > 0){
+		MaxRecords = DataSectors * RecordsPerSector;
+		return;
+	}
+	
+	// the checkpoint sectors (if used) are not data
+	MaxRecords = ((Chip->Capacity - DataStart) / RecordLength) - 2;
+}
+
+// data field addField methods
+uint8_t TeensyDB::newField(uint8_t Type, void *Data, uint16_t Length) {
+	
+	// field numbers are 1 based, the record has to fit the record buffers and the field list the schema
+	if (((FieldCount + 1) >= MAX_FIELDS) || ((RecordLength + Length) > TEENSYDB_MAXREXORDLENGTH) ||
+		(Schema && (!schemaFits(FieldCount + 1)))){
+		return 0;
+	}
+	
+	FieldCount++;
+	
+	DataType[FieldCount] = Type;
+	FieldStart[FieldCount] = RecordLength;
+	FieldLength[FieldCount] = Length;
+	FieldData[FieldCount] = Data;
+	RecordLength = RecordLength + Length;
+	findMaxRecords();
+	return FieldCount;
+}
+
+uint8_t TeensyDB::addField(uint8_t *Data) {
+	return newField(DT_U8, Data, sizeof(*Data));
+}
+
+#ifndef TEENSYDB_NO_INT_OVERLOAD
+
+uint8_t TeensyDB::addField(int *Data) {
+	return newField(DT_INT, Data, sizeof(*Data));
+}
+
+#endif
+
+uint8_t TeensyDB::addField(int16_t *Data) {
+	return newField(DT_I16, Data, sizeof(*Data));
+}
+
+uint8_t TeensyDB::addField(uint16_t *Data) {
+	return newField(DT_U16, Data, sizeof(*Data));
+}
+
+uint8_t TeensyDB::addField(int32_t *Data) {
+	return newField(DT_I32, Data, sizeof(*Data));
+}
+
+uint8_t TeensyDB::addField(uint32_t *Data) {
+	return newField(DT_U32, Data, sizeof(*Data));
+}
+
+uint8_t TeensyDB::addField(float *Data) {
+	return newField(DT_FLOAT, Data, sizeof(*Data));
+}
+
+uint8_t TeensyDB::addField(double *Data) {
+	return newField(DT_DOUBLE, Data, sizeof(*Data));
+}
+
+uint8_t TeensyDB::addField(char *Data, uint16_t len) {
+	return newField(DT_CHAR, Data, len);
+}
+
+/*
+
+bit fields and scaled fields, a flag or a 12 bit ADC reading doesn't need a whole byte or two. bit fields are packed
+one after the other (most significant bit first) into bytes of their own, bytes are only added when the next field
+won't fit in the bits left over (bit fields added one after the other share one run of bytes). a scaled field stores a float as a whole number of Scale steps above Offset
+in Bits bits, so 0.00 to 40.95 in steps of 0.01 takes 12 bits instead of a 4 byte float. values outside the range
+are clipped to it
+
+*/
+
+uint16_t TeensyDB::addBits(uint8_t Bits){
+	
+	uint16_t Bit = BitEnd;
+	
+	// the last run of bits is at the end of the record, make it longer
+	if (((BitEnd + Bits) > BitLimit) && (BitLimit == (RecordLength * 8)) && (BitLimit > 0)){
+		RecordLength = RecordLength + ((BitEnd + Bits - BitLimit + 7) / 8);
+		BitLimit = RecordLength * 8;
+	}
+	
+	// otherwise start a new run of bytes if this field won't fit in what's left of the last one
+	if ((BitEnd + Bits) > BitLimit){
+		Bit = RecordLength * 8;
+		RecordLength = RecordLength + ((Bits + 7) / 8);
+		BitLimit = RecordLength * 8;
+	}
+	
+	BitEnd = Bit + Bits;
+	
+	FieldBit[FieldCount] = Bit;
+	FieldBits[FieldCount] = Bits;
+	FieldStart[FieldCount] = Bit / 8;
+	FieldLength[FieldCount] = ((Bit % 8) + Bits + 7) / 8;
+	
+	return Bit;
+	
+}
+
+uint8_t TeensyDB::addBitField(uint8_t *Data, uint8_t Bits) {
+	
+	if ((Bits < 1) || (Bits > 8) || ((RecordLength + ((Bits + 7) / 8)) > TEENSYDB_MAXREXORDLENGTH)){
+		return 0;
+	}
+	
+	if (newField(DT_BITS8, Data, 0) == 0){
+		return 0;
+	}
+	
+	addBits(Bits);
+	findMaxRecords();
+	return FieldCount;
+}
+
+uint8_t TeensyDB::addBitField(bool *Data) {
+	
+	return addBitField((uint8_t *) Data, 1);
+	
+}
+
+uint8_t TeensyDB::addBitField(uint16_t *Data, uint8_t Bits) {
+	
+	if ((Bits < 1) || (Bits > 16) || ((RecordLength + ((Bits + 7) / 8)) > TEENSYDB_MAXREXORDLENGTH)){
+		return 0;
+	}
+	
+	if (newField(DT_BITS16, Data, 0) == 0){
+		return 0;
+	}
+	
+	addBits(Bits);
+	findMaxRecords();
+	return FieldCount;
+}
+
+uint8_t TeensyDB::addBitField(uint32_t *Data, uint8_t Bits) {
+	
+	if ((Bits < 1) || (Bits > 32) || ((RecordLength + ((Bits + 7) / 8)) > TEENSYDB_MAXREXORDLENGTH)){
+		return 0;
+	}
+	
+	if (newField(DT_BITS32, Data, 0) == 0){
+		return 0;
+	}
+	
+	addBits(Bits);
+	findMaxRecords();
+	return FieldCount;
+}
+
+uint8_t TeensyDB::addScaledField(float *Data, float Scale, float Offset, uint8_t Bits) {
+	
+	if ((Bits < 1) || (Bits > 32) || (Scale <= 0) || ((RecordLength + ((Bits + 7) / 8)) > TEENSYDB_MAXREXORDLENGTH)){
+		return 0;
+	}
+	
+	if (newField(DT_SCALED, Data, 0) == 0){
+		return 0;
+	}
+	
+	addBits(Bits);
+	FieldScale[FieldCount] = Scale;
+	FieldOffset[FieldCount] = Offset;
+	findMaxRecords();
+	return FieldCount;
+}
+
+bool TeensyDB::isBitField(uint8_t Field){
+	
+	return (DataType[Field] >= DT_BITS8) && (DataType[Field] <= DT_SCALED);
+	
+}
+
+uint32_t TeensyDB::getBits(const uint8_t *Bytes, uint8_t Field){
+	
+	uint32_t Value = 0;
+	uint16_t Bit = FieldBit[Field];
+	uint8_t k = 0;
+	
+	for (k = 0; k < FieldBits[Field]; k++, Bit++){
+		Value = (Value << 1) | ((Bytes[Bit / 8] >> (7 - (Bit % 8))) & 1);
+	}
+	
+	return Value;
+	
+}
+
+void TeensyDB::putBits(uint8_t *Bytes, uint8_t Field, uint32_t Value){
+	
+	uint16_t Bit = FieldBit[Field] + FieldBits[Field] - 1;
+	uint8_t k = 0;
+	
+	// least significant bit last
+	for (k = 0; k < FieldBits[Field]; k++, Bit--){
+		if (Value & 1){
+			Bytes[Bit / 8] |= (0x80 >> (Bit % 8));
+		}
+		else {
+			Bytes[Bit / 8] &= ~(0x80 >> (Bit % 8));
+		}
+		Value = Value >> 1;
+	}
+	
+}
+
+uint32_t TeensyDB::scaleValue(uint8_t Field, float Value){
+	
+	float Steps = (Value - FieldOffset[Field]) / FieldScale[Field];
+	float Top = (FieldBits[Field] == 32) ? 4294967295.0f : (float) ((1UL << FieldBits[Field]) - 1);
+	
+	if (Steps <= 0){
+		return 0;
+	}
+	if (Steps >= Top){
+		return (uint32_t) Top;
+	}
+	
+	return (uint32_t) (Steps + 0.5f);
+	
+}
+
+void TeensyDB::listFields() {
+
+	for (i = 1; i <= FieldCount; i++){
+		Serial.print("Field: ");
+		Serial.print(i);
+		Serial.print(", start: ");
+		Serial.print(FieldStart[i]);
+		Serial.print(", Length: ");
+		Serial.println(FieldLength[i]);
+			
+	}
+	
+	Serial.print("Record length: ");Serial.println(RecordLength);
+	Serial.print("Field count: ");Serial.println(FieldCount);
+	
+}
+
+
+uint32_t TeensyDB::gotoLastRecord(){
+	
+	CurrentRecord = LastRecord;
+	getAddress();
+	return CurrentRecord;
+		
+}
+
+uint8_t TeensyDB::getFieldCount(){
+	return FieldCount;
+}
+
+uint16_t TeensyDB::getFieldLength(uint8_t Index){
+	return FieldLength[Index];
+}
+
+uint16_t TeensyDB::getFieldStart(uint8_t Index){
+	return FieldStart[Index];
+}
+
+uint16_t TeensyDB::getRecordLength(){
+	return RecordLength;
+}
+
+uint16_t TeensyDB::getDataLength(){
+	return RecordLength - CheckLength;
+}
+
+uint32_t TeensyDB::getUsedSpace(){
+	
+	if (Compress){
+		return CompAddress - DataStart;
+	}
+
+	if (RingMode && (LastRecord > 0)){
+		return (LastRecord - getFirstRecord() + 1) * RecordLength;
+	}
+	
+	return LastRecord * RecordLength;
+}
+
+uint32_t TeensyDB::getTotalSpace(){
+	return Chip->Capacity - DataStart;
+}
+
+void TeensyDB::B2ToBytes(uint8_t *bytes, int16_t var) {
+  bytes[0] = (uint8_t) (var >> 8);
+  bytes[1] = (uint8_t) (var);
+}
+
+void TeensyDB::B2ToBytes(uint8_t *bytes, uint16_t var) {
+  bytes[0] = (uint8_t) (var >> 8);
+  bytes[1] = (uint8_t) (var);
+}
+#ifndef TEENSYDB_NO_INT_OVERLOAD
+
+void TeensyDB::B4ToBytes(uint8_t *bytes, int var) {
+  bytes[0] = (uint8_t) (var >> 24);
+  bytes[1] = (uint8_t) (var >> 16);
+  bytes[2] = (uint8_t) (var >> 8);
+  bytes[3] = (uint8_t) (var);
+  
+}
+
+#endif
+
+void TeensyDB::B4ToBytes(uint8_t *bytes, int32_t var) {
+  bytes[0] = (uint8_t) (var >> 24);
+  bytes[1] = (uint8_t) (var >> 16);
+  bytes[2] = (uint8_t) (var >> 8);
+  bytes[3] = (uint8_t) (var);
+}
+
+void TeensyDB::B4ToBytes(uint8_t *bytes, uint32_t var) {
+  bytes[0] = (uint8_t) (var >> 24);
+  bytes[1] = (uint8_t) (var >> 16);
+  bytes[2] = (uint8_t) (var >> 8);
+  bytes[3] = (uint8_t) (var);
+    
+}
+
+uint32_t TeensyDB::BytesToB4(const uint8_t *bytes) {
+  return ((uint32_t) bytes[0] << 24) | ((uint32_t) bytes[1] << 16) | ((uint32_t) bytes[2] << 8) | bytes[3];
+}
+
+void TeensyDB::FloatToBytes(uint8_t *bytes, float var) {
+	
+  memcpy(bytes, (uint8_t*) (&var), 4);
+}
+
+void TeensyDB::DoubleToBytes(uint8_t *bytes, double var) {
+	
+  memcpy(bytes, (uint8_t*) (&var), 8);
+  
+}
+
+bool TeensyDB::addRecord(){
+	
+	// special case for address = 0 (new card)
+	// write to address 0, otherwise advance address to next record
+	// save record does not advance address it returns to it's initial address
+		
+	if (!ReadComplete){
+		findFirstWritableRecord();
+		ReadComplete = true;
+	}
+	
+	if (SchemaBad || ReadOnly) {
+		RecordAdded = false;
+		return false;
+	}
+	
+	if (CurrentRecord >= MaxRecords) {
+		RecordAdded = false;
+		return false;
+	}
+	
+	// a table takes the next free sector when it fills the ones it has
+	if ((Table > 0) && ((CurrentRecord % RecordsPerSector) == 0) && (recordExtent(CurrentRecord + 1) >= Extents) && (!allocateExtent())) {
+		RecordAdded = false;
+		return false;
+	}
+	
+	// compressed, room for a worst case entry in a new block
+	if (Compress && ((CompAddress + Chip->PageSize + 5 + RecordLength + (2 * FieldCount)) > Chip->Capacity)) {
+		RecordAdded = false;
+		return false;
+	}
+	
+	// now that record is written, bump the address to the next writable
+	// address
+	
+	CurrentRecord++;
+	LastRecord++;
+	RecordAdded = true;
+	getAddress();
+	return true;
+		
+}
+
+void TeensyDB::dumpBytes() {
+	
+	uint32_t Record = 0;
+	uint32_t InvalidRecords = 0;
+	uint32_t Chunk = 0;
+	uint32_t r = 0;
+	uint8_t *bytes;
+	
+	if (RecordLength == 0) {
+		return;
+	}
+	
+	Serial.println("Dump bytes-------------------- "); 
+	
+	// keeping dumping memory until we get 0xFFFF too many times
+	// this will account for any skips
+	// records are pulled a scan buffer at a time, not byte by byte
+	if (RingMode) {
+		Record = getFirstRecord();
+	}
+	
+	while ((InvalidRecords < 10) && (Record <= MaxRecords)){
+		
+		Chunk = chunkRecords(Record, MaxRecords);
+		
+		readRecords(Record, SCANBUF[0], Chunk);
+		
+		for (r = 0; (r < Chunk) && (InvalidRecords < 10); r++){
+			
+			bytes = &SCANBUF[0][r * RecordLength];
+			
+			if (bytes[0] == NULL_RECORD) {
+				InvalidRecords++;
+			}
+			
+			Serial.print("Address: "); Serial.print(recordAddress(Record));
+			Serial.print(", Record: "); Serial.print(Record); 
+			Serial.print(" - ");
+			
+			for (j = 0; j < RecordLength; j++){
+				Serial.print(bytes[j]);
+				Serial.print("-");
+			}
+			Serial.println("");
+			
+			Record++;
+		}
+
+	}
+
+}
+
+/*
+
+scan is the bulk export path. instead of gotoRecord / getField per record (one chip transaction per record)
+records are streamed into one half of a double buffer with a single FASTREAD that covers as many whole records
+as the half will hold. the callback is then called for each record in that half and getField / getCharField
+decode straight out of the scan buffer. the chip is deselected between buffer fills so the callback is free
+to use the SPI bus, for example to write the records to an SD card
+
+with Prefetch the next half is filled by DMA while the callback works through the current half, so the SPI clock
+and the callback overlap. the bus is busy during the callback so in this case the callback must NOT use the SPI bus
+
+*/
+
+uint32_t TeensyDB::scan(uint32_t StartRecord, uint32_t EndRecord, TeensyDBScanCallback Callback, bool Prefetch){
+	
+	uint32_t TempRecord = CurrentRecord;
+	uint32_t Record = 0;
+	uint32_t NextRecord = 0;
+	uint32_t Count = 0;
+	uint32_t Chunk = 0;
+	uint32_t NextChunk = 0;
+	uint32_t r = 0;
+	uint8_t Half = 0;
+	bool Continue = true;
+	
+	if ((RecordLength == 0) || (Callback == NULL)) {
+		return 0;
+	}
+	
+	if (StartRecord < getFirstRecord()) {
+		StartRecord = getFirstRecord();
+	}
+	if (EndRecord > MaxRecords) {
+		EndRecord = MaxRecords;
+	}
+	// ring mode, past the write head is erased or old data
+	if (RingMode && (EndRecord > LastRecord)) {
+		EndRecord = LastRecord;
+	}
+	if (StartRecord > EndRecord) {
+		return 0;
+	}
+	
+	Record = StartRecord;
+	
+	Chunk = chunkRecords(Record, EndRecord);
+	readRecords(Record, SCANBUF[Half], Chunk);
+	
+	while (Continue && (Chunk > 0)) {
+		
+		// work out the next chunk, with Prefetch it's read into the other half
+		// by DMA while the callback works on this half
+		NextRecord = Record + Chunk;
+		NextChunk = 0;
+		if (NextRecord <= EndRecord) {
+			NextChunk = chunkRecords(NextRecord, EndRecord);
+		}
+		if (Prefetch && (NextChunk > 0)) {
+			readRecords(NextRecord, SCANBUF[Half ^ 1], NextChunk, false);
+		}
+		
+		for (r = 0; r < Chunk; r++){
+			
+			// point the record buffer at this record so getField works as normal
+			CurrentRecord = Record;
+			CachedRecord = Record;
+			RecordCached = true;
+			RecPtr = &SCANBUF[Half][r * RecordLength];
+			RecordValid = true;
+			
+			// cut off by a power loss, skip it
+			if (!checkRecord(RecPtr)){
+				Record++;
+				continue;
+			}
+			
+			// scanWhere, skip the records that don't match
+			if ((WhereField > 0) && ((fieldValue(RecPtr, WhereField) < WhereLow) || (fieldValue(RecPtr, WhereField) > WhereHigh))){
+				Record++;
+				continue;
+			}
+			
+			Count++;
+			
+			if (!Callback(Record)) {
+				Continue = false;
+				break;
+			}
+			
+			Record++;
+		}
+		
+		if (Prefetch) {
+			Device->waitTransfer();
+		}
+		else if (Continue && (NextChunk > 0)) {
+			readRecords(NextRecord, SCANBUF[Half ^ 1], NextChunk);
+		}
+		
+		Record = NextRecord;
+		Chunk = NextChunk;
+		Half ^= 1;
+	}
+	
+	ScanStopped = !Continue;
+	
+	// back to the normal record buffer
+	RecPtr = RBUF;
+	RecordCached = false;
+	CurrentRecord = TempRecord;
+	
+	return Count;
+	
+}
+
+/*
+
+aggregates, statistics for one or more numeric fields in a single pass. records come off the chip a scan buffer at a
+time (the next buffer is read by DMA while this one is decoded) and the fields are decoded straight from the buffer,
+no gotoRecord / getField per record. the mean and standard deviation are kept with Welford's method so a long run of
+large values doesn't lose precision the way sum of squares does
+
+*/
+
+TeensyDBAggregate TeensyDB::aggregate(uint8_t Field, uint32_t StartRecord, uint32_t EndRecord){
+	
+	TeensyDBAggregate Result;
+	
+	aggregate(&Field, 1, &Result, StartRecord, EndRecord);
+	
+	return Result;
+	
+}
+
+uint32_t TeensyDB::aggregate(const uint8_t *Fields, uint8_t Count, TeensyDBAggregate *Results, uint32_t StartRecord, uint32_t EndRecord){
+	
+	uint32_t Record = 0;
+	uint32_t NextRecord = 0;
+	uint32_t Chunk = 0;
+	uint32_t NextChunk = 0;
+	uint32_t Records = 0;
+	uint32_t r = 0;
+	uint8_t Half = 0;
+	uint8_t i = 0;
+	uint8_t *Bytes;
+	double Value = 0;
+	double Delta = 0;
+	bool Good = true;
+	
+	// every field is checked before any result is touched, then all of them start at 0
+	for (i = 0; i < Count; i++){
+		if ((Fields[i] < 1) || (Fields[i] > FieldCount) || (DataType[Fields[i]] == DT_CHAR)){
+			Good = false;
+		}
+	}
+	
+	for (i = 0; i < Count; i++){
+		Results[i].Count = 0;
+		Results[i].Min = 0;
+		Results[i].Max = 0;
+		Results[i].Sum = 0;
+		Results[i].Mean = 0;
+		Results[i].StdDev = 0;
+	}
+	
+	if ((!Good) || (RecordLength == 0) || (Count == 0)) {
+		return 0;
+	}
+	
+	// only records that were written
+	if (StartRecord < getFirstRecord()) {
+		StartRecord = getFirstRecord();
+	}
+	if (EndRecord > LastRecord) {
+		EndRecord = LastRecord;
+	}
+	if (StartRecord > EndRecord) {
+		return 0;
+	}
+	
+	Record = StartRecord;
+	Chunk = chunkRecords(Record, EndRecord);
+	readRecords(Record, SCANBUF[Half], Chunk);
+	
+	while (Chunk > 0) {
+		
+		NextRecord = Record + Chunk;
+		NextChunk = 0;
+		if (NextRecord <= EndRecord) {
+			NextChunk = chunkRecords(NextRecord, EndRecord);
+			readRecords(NextRecord, SCANBUF[Half ^ 1], NextChunk, false);
+		}
+		
+		for (r = 0; r < Chunk; r++){
+			
+			Bytes = &SCANBUF[Half][r * RecordLength];
+			
+			if (!checkRecord(Bytes)){
+				continue;
+			}
+			
+			Records++;
+			
+			for (i = 0; i < Count; i++){
+				
+				Value = fieldValue(Bytes, Fields[i]);
+				
+				if ((Records == 1) || (Value < Results[i].Min)){
+					Results[i].Min = Value;
+				}
+				if ((Records == 1) || (Value > Results[i].Max)){
+					Results[i].Max = Value;
+				}
+				
+				// StdDev holds the running sum of squared differences until the end
+				Results[i].Sum = Results[i].Sum + Value;
+				Delta = Value - Results[i].Mean;
+				Results[i].Mean = Results[i].Mean + (Delta / Records);
+				Results[i].StdDev = Results[i].StdDev + (Delta * (Value - Results[i].Mean));
+			}
+		}
+		
+		Device->waitTransfer();
+		
+		Record = NextRecord;
+		Chunk = NextChunk;
+		Half ^= 1;
+	}
+	
+	for (i = 0; i < Count; i++){
+		Results[i].Count = Records;
+		// sample standard deviation
+		Results[i].StdDev = (Records > 1) ? sqrt(Results[i].StdDev / (Records - 1)) : 0;
+	}
+	
+	return Records;
+	
+}
+
+/*
+
+key field, a field that only goes up from one record to the next (a timestamp or sample counter) can be declared the key
+so a record can be found by value with a binary search on the chip, log2(records) small reads instead of a walk.
+the optional index keeps the key of every IndexStride'th record in RAM (TEENSYDB_KEYINDEX entries spread over the
+whole chip), which narrows the search to one stride before the chip is read. it's built on the first seek and kept
+up to date as records are saved
+
+*/
+
+bool TeensyDB::setKeyField(uint8_t Field, bool Index){
+	
+	if ((Field < 1) || (Field > FieldCount)){
+		return false;
+	}
+	
+	// unsigned whole numbers only, they sort the same as their bytes
+	if ((DataType[Field] != DT_U8) && (DataType[Field] != DT_U16) && (DataType[Field] != DT_U32)){
+		return false;
+	}
+	
+	KeyField = Field;
+	KeyIndex = Index;
+	IndexBuilt = false;
+	
+	return true;
+	
+}
+
+uint32_t TeensyDB::seekKey(uint32_t Value){
+	
+	uint32_t First = getFirstRecord();
+	uint32_t Last = LastRecord;
+	uint32_t Middle = 0;
+	uint16_t e = 0;
+	
+	if ((KeyField == 0) || (LastRecord == 0)){
+		return 0;
+	}
+	
+	if (KeyIndex){
+		
+		if (!IndexBuilt){
+			buildKeyIndex();
+		}
+		
+		// narrow the search to the records between two index entries
+		for (e = 0; e < TEENSYDB_KEYINDEX; e++){
+			
+			if ((IndexRecord[e] < First) || (IndexRecord[e] > Last)){
+				continue;
+			}
+			if (IndexKey[e] < Value){
+				First = IndexRecord[e];
+			}
+		}
+		for (e = 0; e < TEENSYDB_KEYINDEX; e++){
+			
+			if ((IndexRecord[e] < First) || (IndexRecord[e] > Last)){
+				continue;
+			}
+			if (IndexKey[e] >= Value){
+				Last = IndexRecord[e];
+			}
+		}
+	}
+	
+	// every key is smaller
+	if (readKey(Last) < Value){
+		return 0;
+	}
+	
+	// first record with a key >= Value
+	while (First < Last){
+		Middle = First + ((Last - First) / 2);
+		if (readKey(Middle) < Value){
+			First = Middle + 1;
+		}
+		else {
+			Last = Middle;
+		}
+	}
+	
+	gotoRecord(First);
+	
+	return First;
+	
+}
+
+uint32_t TeensyDB::scanKeys(uint32_t FromKey, uint32_t ToKey, TeensyDBScanCallback Callback, bool Prefetch){
+	
+	uint32_t StartRecord = 0;
+	uint32_t EndRecord = 0;
+	
+	StartRecord = seekKey(FromKey);
+	
+	if (StartRecord == 0){
+		return 0;
+	}
+	
+	// the record before the first one past ToKey
+	EndRecord = LastRecord;
+	if (ToKey < 0xFFFFFFFF){
+		EndRecord = seekKey(ToKey + 1);
+		if (EndRecord == 0){
+			EndRecord = LastRecord;
+		}
+		else {
+			EndRecord--;
+		}
+	}
+	
+	if (EndRecord < StartRecord){
+		return 0;
+	}
+	
+	return scan(StartRecord, EndRecord, Callback, Prefetch);
+	
+}
+
+void TeensyDB::buildKeyIndex(){
+	
+	uint32_t Record = 0;
+	uint32_t Records = 0;
+	uint16_t e = 0;
+	
+	if (KeyField == 0){
+		return;
+	}
+	
+	for (e = 0; e < TEENSYDB_KEYINDEX; e++){
+		IndexRecord[e] = 0;
+	}
+	
+	// spread the entries over the whole chip so the index never runs out
+	Records = (RingMode || (Table > 0)) ? (DataSectors * RecordsPerSector) : MaxRecords;
+	IndexStride = (Records / TEENSYDB_KEYINDEX) + 1;
+	
+	Record = ((getFirstRecord() + IndexStride - 1) / IndexStride) * IndexStride;
+	
+	while ((Record > 0) && (Record <= LastRecord)){
+		addKeyIndex(Record, readKey(Record));
+		Record = Record + IndexStride;
+	}
+	
+	IndexBuilt = true;
+	
+}
+
+void TeensyDB::addKeyIndex(uint32_t Record, uint32_t Key){
+	
+	// the ring only ever holds TEENSYDB_KEYINDEX strides, so an entry is only overwritten once its record is gone
+	uint16_t e = (Record / IndexStride) % TEENSYDB_KEYINDEX;
+	
+	IndexRecord[e] = Record;
+	IndexKey[e] = Key;
+	
+}
+
+uint32_t TeensyDB::readKey(uint32_t Record){
+	
+	uint8_t Bytes[4];
+	
+	if (Compress){
+		readPacked(Record, SCANBUF[0]);
+		return decodeKey(&SCANBUF[0][FieldStart[KeyField]]);
+	}
+	
+	readBytes(recordAddress(Record) + FieldStart[KeyField], Bytes, FieldLength[KeyField]);
+	
+	return decodeKey(Bytes);
+	
+}
+
+uint32_t TeensyDB::decodeKey(const uint8_t *Bytes){
+	
+	// big endian, the same as encodeRecord
+	if (DataType[KeyField] == DT_U8){
+		return Bytes[0];
+	}
+	if (DataType[KeyField] == DT_U16){
+		return ((uint32_t) Bytes[0] << 8) | Bytes[1];
+	}
+	
+	return ((uint32_t) Bytes[0] << 24) | ((uint32_t) Bytes[1] << 16) | ((uint32_t) Bytes[2] << 8) | Bytes[3];
+	
+}
+
+void TeensyDB::eraseAll(){
+	
+	// no point in writing what's pending, it's about to be erased
+	finishProgram();
+	WQCount = 0;
+	PendingRecords = 0;
+	
+	// or in erasing the rest of a range, the chip won't start a chip erase with one suspended
+	EraseNext = 0;
+	EraseEnd = 0;
+	finishErase();
+	
+	Device->erase(ERASE_CHIP, 0);
+	TEENSYDB_STAT(Stats.Erases++);
+	waitForChip(Chip->ChipEraseTime, LATENCY_ERASE);
+	
+	
+	NewCard = true;
+	ReadComplete = true;
+	RecordCached = false;
+	LastRecord = 0;
+	CurrentRecord = 0;
+	WQAddress = 0;
+	QueuedRecord = 0;
+	EraseAhead = false;
+	IndexBuilt = false;
+	
+	// compressed blocks start over
+	CompAddress = DataStart;
+	CompRecord = 0;
+	DecBlock = TEENSYDB_NOBLOCK;
+	memset(BlockIndex, 0, sizeof(BlockIndex));
+	if (RecordLength > 0){
+		memset(CompPrev, 0, RecordLength);
+	}
+	
+	// checkpoints went with everything else
+	CheckpointRecord = 0;
+	CheckpointSector = 0;
+	CheckpointSlot = 0;
+	
+	// and the table directory
+	Extents = 0;
+	FreeSector = 0;
+	ExtentCached = TEENSYDB_NOBLOCK;
+	
+	// and the schema, put it back
+	if (Schema && (RecordLength > 0) && (!ReadOnly)){
+		checkSchema();
+	}
+	
+	readChipJEDEC();
+
+}
+	
+void TeensyDB::eraseSector(uint32_t SectorNumber){
+
+	// keep the order of operations, anything pending is written before the erase
+	flush();
+	finishErase();
+
+	Address = SectorNumber * Chip->SectorSize;
+	
+	Device->erase(ERASE_SECTOR, Address);
+	TEENSYDB_STAT(Stats.Erases++);
+	waitForChip(Chip->SectorEraseTime, LATENCY_ERASE);
+	
+	RecordCached = false;
+	
+}
+
+void TeensyDB::eraseSmallBlock(uint32_t BlockNumber){
+
+	// keep the order of operations, anything pending is written before the erase
+	flush();
+	finishErase();
+
+	Address = BlockNumber * Chip->SmallBlockSize;
+	
+	if (Chip->SmallBlockEraseCmd == 0x00) {
+		// no 32k erase on this chip (4 byte address parts), do it a sector at a time
+		for (i = 0; i < (Chip->SmallBlockSize / Chip->SectorSize); i++){
+			Device->erase(ERASE_SECTOR, Address + (i * Chip->SectorSize));
+			TEENSYDB_STAT(Stats.Erases++);
+			waitForChip(Chip->SectorEraseTime, LATENCY_ERASE);
+		}
+	}
+	else {
+		Device->erase(ERASE_SMALLBLOCK, Address);
+		TEENSYDB_STAT(Stats.Erases++);
+		waitForChip(Chip->SmallBlockEraseTime, LATENCY_ERASE);
+	}
+	
+	RecordCached = false;
+	
+}
+void TeensyDB::eraseLargeBlock(uint32_t BlockNumber){
+
+	// keep the order of operations, anything pending is written before the erase
+	flush();
+	finishErase();
+
+	Address = BlockNumber * Chip->LargeBlockSize;
+	
+	Device->erase(ERASE_LARGEBLOCK, Address);
+	TEENSYDB_STAT(Stats.Erases++);
+	waitForChip(Chip->LargeBlockEraseTime, LATENCY_ERASE);
+	
+	RecordCached = false;
+	
+}
+
+
+// get data
+// all getField calls are served from the record buffer, the first call for a record pulls the
+// entire record from the chip in one FASTREAD transaction, subsequent calls for the same record
+// never touch the chip
+	
+uint8_t TeensyDB::getField(uint8_t Data, uint8_t Field){
+
+	loadRecord();
+	
+	return TeensyDBRecord(this, RecPtr).getField(Data, Field);
+
+}
+
+#ifndef TEENSYDB_NO_INT_OVERLOAD
+
+int TeensyDB::getField(int Data, uint8_t Field){
+
+	loadRecord();
+	
+	return TeensyDBRecord(this, RecPtr).getField(Data, Field);
+
+}
+
+#endif
+
+int16_t TeensyDB::getField(int16_t Data, uint8_t Field){
+
+	loadRecord();
+	
+	return TeensyDBRecord(this, RecPtr).getField(Data, Field);
+
+}
+
+uint16_t TeensyDB::getField(uint16_t Data, uint8_t Field){
+
+	loadRecord();
+	
+	return TeensyDBRecord(this, RecPtr).getField(Data, Field);
+
+}
+
+int32_t TeensyDB::getField(int32_t Data, uint8_t Field){
+
+	loadRecord();
+	
+	return TeensyDBRecord(this, RecPtr).getField(Data, Field);
+
+}
+
+uint32_t TeensyDB::getField(uint32_t Data, uint8_t Field){
+
+	loadRecord();
+	
+	return TeensyDBRecord(this, RecPtr).getField(Data, Field);
+
+}
+
+float TeensyDB::getField(float Data, uint8_t Field){
+
+	loadRecord();
+	
+	return TeensyDBRecord(this, RecPtr).getField(Data, Field);
+	
+}
+
+double TeensyDB::getField(double Data, uint8_t Field){
+	
+	loadRecord();
+	
+	return TeensyDBRecord(this, RecPtr).getField(Data, Field);
+	
+}
+
+char  *TeensyDB::getCharField(uint8_t Field){
+	
+	uint16_t len = FieldLength[Field];
+	
+	// stng holds a field as long as a record unless TEENSYDB_MAXDATACHARLEN was set lower
+	if (len > (TEENSYDB_MAXDATACHARLEN - 1)){
+		len = TEENSYDB_MAXDATACHARLEN - 1;
+	}
+	
+	loadRecord();
+	
+	memcpy(stng, &RecPtr[FieldStart[Field]], len);
+	stng[len] = '\0';
+	
+	return stng;
+
+}
+
+uint32_t TeensyDB::getCurrentRecord(){
+	return CurrentRecord;
+	
+}
+
+uint32_t TeensyDB::getLastRecord(){
+	return LastRecord;
+}
+
+void TeensyDB::setAddress(uint32_t Address){
+	Address = Address;
+	
+}
+
+uint32_t TeensyDB::getAddress(){
+	return Address;
+	
+}
+
+void TeensyDB::gotoRecord(uint32_t RecordNumber){
+	
+	if (RecordNumber > MaxRecords){
+		CurrentRecord = MaxRecords;
+	}
+	else {
+		CurrentRecord = RecordNumber;
+	}
+	
+	Address = recordAddress(CurrentRecord);
+
+}
+
+bool TeensyDB::saveRecord() {
+	
+	TEENSYDB_STAT(uint32_t Start = micros());
+	
+	if (SchemaBad || ReadOnly) {
+		return false;
+	}
+	
+	encodeRecord();
+	writeRecord();
+	
+	// the save may have suspended an erase
+	if (EraseSuspended || (EraseNext < EraseEnd)){
+		eraseStep();
+	}
+	
+	TEENSYDB_STAT(addLatency(LATENCY_SAVE, Start));
+		
+	return true;
+	
 }
 
-void TeensyDB::listFields() {
+/*
 
-	for (i = 1; i <= FieldCount; i++){
-		Serial.print("Field: ");
-		Serial.print(i);
-		Serial.print(", start: ");
-		Serial.print(FieldStart[i]);
-		Serial.print(", Length: ");
-		Serial.println(FieldLength[i]);
-			
+saveRecordAsync is for acquisition loops that can't wait on the chip. the record is encoded and dropped into the write
+queue, and if the chip is idle a page program is started, then we return without waiting for the program to finish.
+each later call to saveRecordAsync() or poll() checks the chip status once and, when the program is done, starts the next
+one. records saved while a program is running simply accumulate in the queue and go out together in the next program.
+the only time this blocks is when the queue is full, then we wait for enough room (see getQueueHighWater to size the queue)
+
+*/
+
+bool TeensyDB::saveRecordAsync() {
+	
+	TEENSYDB_STAT(uint32_t Start = micros());
+	
+	if (SchemaBad || ReadOnly) {
+		return false;
 	}
 	
-	Serial.print("Record length: ");Serial.println(RecordLength);
-	Serial.print("Field count: ");Serial.println(FieldCount);
+	encodeRecord();
+	queueRecord();
+	poll();
+	
+	TEENSYDB_STAT(addLatency(LATENCY_SAVEASYNC, Start));
+	
+	return true;
 	
 }
 
+/*
+
+records that are already laid out, TeensyDBTable encodes a struct with the offsets worked out by the compiler and
+hands the bytes over here, they go out the same way as saveRecord / saveRecordAsync. readRecord is the other
+direction, the record is read into the record buffer without moving the current record
 
-uint32_t TeensyDB::gotoLastRecord(){
+*/
+
+bool TeensyDB::saveRecord(const uint8_t *Bytes, uint16_t Length) {
+	
+	TEENSYDB_STAT(uint32_t Start = micros());
+	
+	if (!copyRecord(Bytes, Length)) {
+		return false;
+	}
+	writeRecord();
+	
+	// the save may have suspended an erase
+	if (EraseSuspended || (EraseNext < EraseEnd)){
+		eraseStep();
+	}
+	
+	TEENSYDB_STAT(addLatency(LATENCY_SAVE, Start));
+	
+	return true;
 	
-	CurrentRecord = LastRecord;
-	getAddress();
-	return CurrentRecord;
-		
 }
 
-uint8_t TeensyDB::getFieldCount(){
-	return FieldCount;
+bool TeensyDB::saveRecordAsync(const uint8_t *Bytes, uint16_t Length) {
+	
+	TEENSYDB_STAT(uint32_t Start = micros());
+	
+	if (!copyRecord(Bytes, Length)) {
+		return false;
+	}
+	queueRecord();
+	poll();
+	
+	TEENSYDB_STAT(addLatency(LATENCY_SAVEASYNC, Start));
+	
+	return true;
+	
 }
 
-uint8_t TeensyDB::getFieldLength(uint8_t Index){
-	return FieldLength[Index];
+bool TeensyDB::copyRecord(const uint8_t *Bytes, uint16_t Length) {
+	
+	// the bytes have to be laid out for these fields, a short buffer would be read past
+	if (SchemaBad || ReadOnly || (Length != (RecordLength - CheckLength))) {
+		return false;
+	}
+	
+	memcpy(RECORD, Bytes, Length);
+	sealRecord();
+	
+	return true;
+	
 }
 
-uint8_t TeensyDB::getFieldStart(uint8_t Index){
-	return FieldStart[Index];
+const uint8_t *TeensyDB::readRecord(uint32_t Record) {
+	
+	// in ring mode the records before the first one have been written over
+	if ((Record == 0) || (Record < getFirstRecord()) || (Record > LastRecord)){
+		return NULL;
+	}
+	
+	if (!(RecordCached && (CachedRecord == Record) && (RecPtr == RBUF))){
+		RecPtr = RBUF;
+		readRecords(Record, RBUF, 1);
+		RecordValid = checkRecord(RBUF);
+		if ((!RecordValid) && (!isErased(RBUF, RecordLength))){
+			memset(RBUF, 0, RecordLength);
+		}
+		CachedRecord = Record;
+		RecordCached = true;
+	}
+	
+	return RecordValid ? RBUF : NULL;
+	
 }
 
-uint16_t TeensyDB::getRecordLength(){
-	return RecordLength;
+/*
+
+instrumentation, counters for what the chip is asked to do and log2 histograms of how long the hot paths take, so
+program and erase tail latency and chip timeouts show up in the field without a debugger. each one is an add or two
+and a micros() call, and -DTEENSYDB_NO_STATS takes all of it out. status polls are counted by the device (isReady
+and waitReady read the status register)
+
+*/
+
+TeensyDBStats TeensyDB::getStats() {
+	
+#ifndef TEENSYDB_NO_STATS
+	Stats.StatusPolls = Device->getStatusPolls() - PollStart;
+	Stats.Transactions = Stats.Reads + Stats.Programs + Stats.Erases + Stats.StatusPolls + Stats.Suspends + Stats.Resumes;
+	
+	return Stats;
+#else
+	TeensyDBStats Empty;
+	
+	memset(&Empty, 0, sizeof(Empty));
+	
+	return Empty;
+#endif
+	
 }
 
-uint32_t TeensyDB::getUsedSpace(){
+void TeensyDB::resetStats() {
+	
+#ifndef TEENSYDB_NO_STATS
+	memset(&Stats, 0, sizeof(Stats));
+	PollStart = Device->getStatusPolls();
+#endif
+	
+}
 
-	return LastRecord * RecordLength;
+bool TeensyDB::waitForChip(uint32_t Timeout, uint8_t Latency) {
+	
+	bool Ready = false;
+	TEENSYDB_STAT(uint32_t Start = micros());
+	
+	Ready = Device->waitReady(Timeout);
+	
+	TEENSYDB_STAT(addLatency(Latency, Start));
+	if (!Ready){
+		TEENSYDB_STAT(Stats.Timeouts++);
+	}
+	
+	return Ready;
+	
 }
 
-uint32_t TeensyDB::getTotalSpace(){
-	return CARD_SIZE;
+void TeensyDB::addLatency(uint8_t Latency, uint32_t Start) {
+	
+#ifndef TEENSYDB_NO_STATS
+	uint32_t Time = micros() - Start;
+	uint8_t Bucket = 0;
+	TeensyDBHistogram *Histogram = &Stats.Latency[Latency];
+	
+	// the bucket is the bit length of the time, one count leading zeros instruction on an ARM
+	if (Time > 0){
+		Bucket = 32 - __builtin_clz(Time);
+		if (Bucket >= TEENSYDB_HISTOGRAM){
+			Bucket = TEENSYDB_HISTOGRAM - 1;
+		}
+	}
+	
+	Histogram->Bucket[Bucket]++;
+	Histogram->Count++;
+	if (Time > Histogram->Max){
+		Histogram->Max = Time;
+	}
+#endif
+	
 }
 
-void TeensyDB::B2ToBytes(uint8_t *bytes, int16_t var) {
-  bytes[0] = (uint8_t) (var >> 8);
-  bytes[1] = (uint8_t) (var);
+/*
+
+record views, getRecord hands back where the record already is (the read buffer, or the scan buffer during a scan)
+and TeensyDBRecord decodes each field from there when it is asked for. a trend display that reads a few fields of
+many records touches each byte once, and char fields come back as a pointer and length instead of a copy into stng
+(where a second getCharField overwrites the first)
+
+*/
+
+TeensyDBRecord TeensyDB::getRecord() {
+	
+	loadRecord();
+	
+	return TeensyDBRecord(this, RecordValid ? RecPtr : NULL);
+	
 }
 
-void TeensyDB::B2ToBytes(uint8_t *bytes, uint16_t var) {
-  bytes[0] = (uint8_t) (var >> 8);
-  bytes[1] = (uint8_t) (var);
+TeensyDBRecord TeensyDB::getRecord(uint32_t Record) {
+	
+	return TeensyDBRecord(this, readRecord(Record));
+	
 }
-void TeensyDB::B4ToBytes(uint8_t *bytes, int var) {
-  bytes[0] = (uint8_t) (var >> 24);
-  bytes[1] = (uint8_t) (var >> 16);
-  bytes[2] = (uint8_t) (var >> 8);
-  bytes[3] = (uint8_t) (var);
-  
+
+void TeensyDB::sealRecord() {
+	
+	if (CheckLength > 0){
+		B2ToBytes(&RECORD[CheckStart], crc16(RECORD, CheckStart));
+		RECORD[CheckStart + 2] = TEENSYDB_COMMIT;
+	}
+	
 }
 
-void TeensyDB::B4ToBytes(uint8_t *bytes, int32_t var) {
-  bytes[0] = (uint8_t) (var >> 24);
-  bytes[1] = (uint8_t) (var >> 16);
-  bytes[2] = (uint8_t) (var >> 8);
-  bytes[3] = (uint8_t) (var);
+bool TeensyDB::poll() {
+	
+	// program or erase in progress?, (page still going out or) one status read and we're out
+	// unless it's an erase and a page is waiting, that may suspend it (see readyFor)
+	if (WriteState != WS_IDLE){
+		
+		if (Device->isReady()){
+			WriteState = WS_IDLE;
+			if (!EraseSuspended){
+				EraseLength = 0;
+			}
+		}
+		else if ((WriteState == WS_PROGRAM) || (WQCount == 0)){
+			return true;
+		}
+	}
+	
+	// a suspended erase carries on as soon as the chip is free, the queue waits for its next slice
+	if ((WriteState == WS_IDLE) && (EraseSuspended || (EraseNext < EraseEnd))){
+		eraseStep();
+	}
+	
+	if (WQCount == 0){
+		PendingRecords = 0;
+		return (WriteState != WS_IDLE) || (EraseNext < EraseEnd);
+	}
+	
+	// with write combining a partial page waits for more records unless a flush limit is reached
+	if (WriteCombine && (WQCount < (Chip->PageSize - (WQAddress % Chip->PageSize)))){
+		
+		if (!(((CombineRecords > 0) && (PendingRecords >= CombineRecords)) || 
+			((CombineTime > 0) && ((millis() - PendingTime) >= CombineTime)))){
+			return true;
+		}
+	}
+	
+	programPage(false);
+	
+	if (WQCount == 0){
+		PendingRecords = 0;
+	}
+	
+	return true;
+	
 }
 
-void TeensyDB::B4ToBytes(uint8_t *bytes, uint32_t var) {
-  bytes[0] = (uint8_t) (var >> 24);
-  bytes[1] = (uint8_t) (var >> 16);
-  bytes[2] = (uint8_t) (var >> 8);
-  bytes[3] = (uint8_t) (var);
-    
+bool TeensyDB::isBusy() {
+	
+	return (WQCount > 0) || (WriteState != WS_IDLE) || EraseSuspended || (EraseNext < EraseEnd);
+	
 }
 
-void TeensyDB::FloatToBytes(uint8_t *bytes, float var) {
+uint16_t TeensyDB::getQueueDepth() {
+	
+	return WQCount;
 	
-  memcpy(bytes, (uint8_t*) (&var), 4);
 }
 
-void TeensyDB::DoubleToBytes(uint8_t *bytes, double var) {
+uint16_t TeensyDB::getQueueHighWater() {
+	
+	return WQHighWater;
 	
-  memcpy(bytes, (uint8_t*) (&var), 8);
-  
 }
 
-bool TeensyDB::addRecord(){
+void TeensyDB::resetQueueHighWater() {
 	
-	// special case for address = 0 (new card)
-	// write to address 0, otherwise advance address to next record
-	// save record does not advance address it returns to it's initial address
+	WQHighWater = WQCount;
+	
+}
+
+void TeensyDB::encodeRecord() {
+	
+	uint8_t *Bytes;
+	const char *Text;
+	uint32_t Value = 0;
+	uint16_t k = 0;
+	
+	// bit fields only set their own bits, start from a clean record
+	memset(RECORD, 0, RecordLength);
+	
+	// fields are 1 based, one jump per field however many types there are
+	for (i= 1; i <= FieldCount; i++){		
 		
-	if (!ReadComplete){
-		findFirstWritableRecord();
-		ReadComplete = true;
+		Bytes = &RECORD[FieldStart[i]];
+		
+		switch (DataType[i]){
+			
+			case DT_U8:
+				Bytes[0] = *(uint8_t *) FieldData[i];
+				break;
+			case DT_I16:
+			case DT_U16:
+				Value = *(uint16_t *) FieldData[i];
+				Bytes[0] = (uint8_t) (Value >> 8);
+				Bytes[1] = (uint8_t) Value;
+				break;
+			case DT_INT:
+			case DT_I32:
+			case DT_U32:
+				Value = (DataType[i] == DT_INT) ? (uint32_t) *(int *) FieldData[i] : *(uint32_t *) FieldData[i];
+				Bytes[0] = (uint8_t) (Value >> 24);
+				Bytes[1] = (uint8_t) (Value >> 16);
+				Bytes[2] = (uint8_t) (Value >> 8);
+				Bytes[3] = (uint8_t) Value;
+				break;
+			case DT_FLOAT:
+			case DT_DOUBLE:
+				// stored as they are in memory
+				memcpy(Bytes, FieldData[i], FieldLength[i]);
+				break;
+			case DT_BITS8:
+				putBits(RECORD, i, *(uint8_t *) FieldData[i]);
+				break;
+			case DT_BITS16:
+				putBits(RECORD, i, *(uint16_t *) FieldData[i]);
+				break;
+			case DT_BITS32:
+				putBits(RECORD, i, *(uint32_t *) FieldData[i]);
+				break;
+			case DT_SCALED:
+				putBits(RECORD, i, scaleValue(i, *(float *) FieldData[i]));
+				break;
+			case DT_CHAR:
+				// the string ends at its 0 or the end of the field, the rest of the field stays 0
+				Text = (const char *) FieldData[i];
+				for (k = 0; (k < FieldLength[i]) && (Text[k] != '\0'); k++){
+					Bytes[k] = Text[k];
+				}
+				break;
+		}
 	}
 	
-	if (CurrentRecord >= MaxRecords) {
-		RecordAdded = false;
-		return false;
+	sealRecord();
+	/*
+	for (q = 0; q < RecordLength; q++){
+		Serial.print(RECORD[q]);
+		Serial.print("-");
+	}
+	Serial.println();
+	*/
+	
+}
+
+uint8_t TeensyDB::readByte() {
+	
+	if (isPending(Address, 1)){
+		flush();
+	}
+	readyFor(Address, 1, true);
+
+	Device->read(Address, &readvalue, 1);
+	TEENSYDB_STAT(Stats.Reads++);
+	TEENSYDB_STAT(Stats.ReadBytes++);
+
+	// since we are reading byte by byte we need to advance address
+	// reading byte arrays is unreliable
+	Address = Address + 1;
+	
+	return readvalue;
+  
+}
+
+void TeensyDB::readBytes(uint32_t Address, uint8_t *Buffer, uint32_t Length, bool Wait) {
+	
+	// a prefetch may still be running
+	Device->waitTransfer();
+	
+	// bytes still sitting in the write queue must get to the chip first
+	if (isPending(Address, Length)){
+		flush();
+	}
+	readyFor(Address, Length, true);
+	
+	// the device reads the whole block in one transaction
+	Device->read(Address, Buffer, Length, Wait);
+	TEENSYDB_STAT(Stats.Reads++);
+	TEENSYDB_STAT(Stats.ReadBytes += Length);
+	
+}
+
+void TeensyDB::loadRecord() {
+	
+	// record is already in the buffer, nothing to read
+	if (RecordCached && (CachedRecord == CurrentRecord)){
+		return;
+	}
+	
+	// a scan may have left the record pointer in the scan buffer
+	RecPtr = RBUF;
+	readRecords(CurrentRecord, RBUF, 1);
+	
+	// a bad record reads as all 0
+	RecordValid = checkRecord(RBUF);
+	if ((!RecordValid) && (!isErased(RBUF, RecordLength))){
+		memset(RBUF, 0, RecordLength);
+	}
+	
+	CachedRecord = CurrentRecord;
+	RecordCached = true;
+	
+}
+
+uint32_t TeensyDB::recordAddress(uint32_t Record) {
+	
+	uint32_t Sector = 0;
+	
+	// a table's sectors are wherever the directory says
+	if ((Table > 0) && (Record > 0) && (RecordsPerSector > 0)){
+		Sector = extentSector(recordExtent(Record));
+		if (Sector == TEENSYDB_NOBLOCK){
+			return DataStart;
+		}
+		return DataStart + (Sector * Chip->SectorSize) + (((Record - 1) % RecordsPerSector) * RecordLength);
+	}
+	
+	if (RecordsPerSector > 0){
+		if (Record == 0){
+			return DataStart;
+		}
+		return DataStart + ((((Record - 1) / RecordsPerSector) % DataSectors) * Chip->SectorSize) + (((Record - 1) % RecordsPerSector) * RecordLength);
+	}
+	
+	// records are 1 based, the first record length of the data area is never used
+	return DataStart + (Record * RecordLength);
+	
+}
+
+/*
+
+writes go through a small ring buffer (the write queue). saveRecord encodes the record into RECORD and writeRecord
+appends it to the queue, the queue is then programmed to the chip one page (or partial page) at a time.
+
+without write combining the queue is programmed right away, which is the same one or two page programs per record as before.
+with write combining, records sit in the queue until a full page is ready, so a 20 byte record costs 1/12th of a
+page program instead of a full one. to bound what is lost on power down, the queue is also flushed when it holds
+CombineRecords records or the oldest record has waited CombineTime ms (either set to 0 to disable that check)
+
+NOR flash lets us program the erased part of a page that was already partially programmed, so flushing a partial page
+and later adding to it is fine
+
+*/
+
+void TeensyDB::setWriteCombine(bool Enable, uint16_t FlushRecords, uint32_t FlushTime){
+	
+	// anything pending under the old settings goes to the chip first
+	flush();
+	
+	WriteCombine = Enable;
+	CombineRecords = FlushRecords;
+	CombineTime = FlushTime;
+	
+}
+
+bool TeensyDB::flush(){
+	
+	while (WQCount > 0){
+		programPage(true);
 	}
 	
-	// now that record is written, bump the address to the next writable
-	// address
+	finishProgram();
+	
+	updateCheckpoint(false);
+	
+	PendingRecords = 0;
+	
+	// an erase isn't waited for, but one suspended for the pages carries on
+	if (EraseSuspended){
+		eraseStep();
+	}
 	
-	CurrentRecord++;
-	LastRecord++;
-	RecordAdded = true;
-	getAddress();
 	return true;
-		
+	
 }
 
-void TeensyDB::dumpBytes() {
+void TeensyDB::writeRecord() {
 	
-	uint32_t TempRecord = 0;
-	uint32_t InvalidRecords = 0;
+	TEENSYDB_STAT(uint32_t Start = micros());
+	
+	queueRecord();
+	
+	if (!WriteCombine){
+		flush();
+	}
+	else {
+		
+		// program every page that is now complete
+		while (WQCount >= (Chip->PageSize - (WQAddress % Chip->PageSize))){
+			programPage(true);
+		}
+		
+		if (WQCount == 0){
+			PendingRecords = 0;
+		}
+		// now the power loss exposure limits
+		else if ((CombineRecords > 0) && (PendingRecords >= CombineRecords)){
+			flush();
+		}
+		else if ((CombineTime > 0) && ((millis() - PendingTime) >= CombineTime)){
+			flush();
+		}
+	}
+	
+	TEENSYDB_STAT(addLatency(LATENCY_WRITE, Start));
+	
+}
 
-	TempRecord = CurrentRecord;
+void TeensyDB::queueRecord() {
 	
-	CurrentRecord = 0;
-	Serial.println("Dump bytes-------------------- "); 
+	uint32_t RecordAddress = recordAddress(CurrentRecord);
+	uint16_t Length = RecordLength;
+	uint16_t Copy = RecordLength;
+	uint16_t Pad = 0;
+	uint16_t Tail = 0;
+	uint16_t q = 0;
+	const uint8_t *Source = RECORD;
 	
-	// keeping dumping memory until we get 0xFFFF too many times
-	// this will account for any skips
+	// the record buffer may be holding this (previously empty) record
+	RecordCached = false;
 	
-	while (InvalidRecords < 10){
+	// compressed, the packed entry goes on the end of the last block
+	if (Compress){
 		
-		Address = CurrentRecord * RecordLength;
+		Length = packRecord(CompPrev, CENTRY);
 		
-		Serial.print("Address: "); Serial.print(Address);
-		Serial.print(", Record: "); Serial.print(CurrentRecord); 
-		Serial.print(" - ");
+		// no room, pad out the page and start a new block with the record packed against zeros
+		if ((((CompAddress - DataStart) % Chip->PageSize) == 0) || ((((CompAddress - DataStart) % Chip->PageSize) + Length) > Chip->PageSize)){
 			
-		for (i = 0; i< RecordLength; i++){
-			readvalue = readByte();
-			if((i == 0) && (readvalue == NULL_RECORD)) {
-				InvalidRecords++;
+			if (((CompAddress - DataStart) % Chip->PageSize) != 0){
+				Pad = Chip->PageSize - ((CompAddress - DataStart) % Chip->PageSize);
+			}
+			
+			memset(CompPrev, 0, RecordLength);
+			B4ToBytes(CENTRY, CompRecord + 1);
+			Length = 4 + packRecord(CompPrev, &CENTRY[4]);
+			
+			q = ((CompAddress + Pad - DataStart) / Chip->PageSize) % BlockStride;
+			if (q == 0){
+				BlockIndex[((CompAddress + Pad - DataStart) / Chip->PageSize) / BlockStride] = CompRecord + 1;
 			}
-			Serial.print(readvalue);
-			Serial.print("-");
 		}
-		Serial.println("");
 		
-		if (CurrentRecord >= MaxRecords) {
-			gotoRecord(TempRecord);
-			return;
-		}
+		RecordAddress = CompAddress;
+		Source = CENTRY;
+		Length = Length + Pad;
+		Copy = Length;
 		
-		CurrentRecord++;
-
+		CompAddress = CompAddress + Length;
+		CompRecord++;
+		memcpy(CompPrev, RECORD, RecordLength);
+		
+		// the block being read may be the one that just grew
+		DecBlock = TEENSYDB_NOBLOCK;
 	}
 	
-	gotoRecord(TempRecord);
-
-}
-
-
-void TeensyDB::eraseAll(){
+	// queue can only hold one contiguous run of addresses, if this record is not
+	// right after what's pending (user moved with gotoRecord) send what we have
+	if ((WQCount > 0) && ((WQAddress + WQCount) != RecordAddress)){
+		flush();
+	}
 	
-	SPI.beginTransaction(SPISettings(SPEED_WRITE, MSBFIRST, SPI_MODE0));
+	// the last record of a sector brings its zone map with it
+	if (ZoneMap && (CurrentRecord > 0) && ((CurrentRecord % RecordsPerSector) == 0)){
+		Length = Length + ZoneLength;
+	}
 	
-	digitalWrite(CSPin, LOW);
-	SPI.transfer(WRITEENABLE);
-	digitalWrite(CSPin, HIGH);
-	waitForChip(50);
-
-
-	digitalWrite(CSPin, LOW);
-	SPI.transfer(CHIPERASE);
-	digitalWrite(CSPin, HIGH);
-	waitForChip(600000);
+	// queue full, this is the only time an async save waits on the chip
+	while ((WQCount + Length) > TEENSYDB_WRITEQUEUE){
+		programPage(true);
+	}
 	
-	SPI.endTransaction();
+	if (WQCount == 0){
+		WQHead = 0;
+		WQAddress = RecordAddress;
+	}
 	
+	if (PendingRecords == 0){
+		PendingTime = millis();
+	}
 	
-	NewCard = true;
-	ReadComplete = true;
-	LastRecord = 0;
-	CurrentRecord = 0;
+	// ring mode, the first record of a sector schedules the erase of the next one
+	if (RingMode && (CurrentRecord > 0) && (((CurrentRecord - 1) % RecordsPerSector) == 0)){
+		EraseAhead = true;
+		EraseAddress = recordAddress(CurrentRecord + RecordsPerSector);
+	}
 	
-	readChipJEDEC();
-
-}
+	QueuedRecord = CurrentRecord;
 	
-void TeensyDB::eraseSector(uint32_t SectorNumber){
-
-	Address = SectorNumber * SECTOR_SIZE;
+	// keep the key index current
+	if (IndexBuilt && ((CurrentRecord % IndexStride) == 0)){
+		addKeyIndex(CurrentRecord, decodeKey(&RECORD[FieldStart[KeyField]]));
+	}
 	
-	buildCommandBytes(CmdBytes, SECTORERASE, Address);
-		
-	SPI.beginTransaction(SPISettings(SPEED_WRITE, MSBFIRST, SPI_MODE0));
-	digitalWrite(CSPin, LOW);
-	SPI.transfer(WRITEENABLE);
-	digitalWrite(CSPin, HIGH);
-
-	waitForChip(60000);
-
-	digitalWrite(CSPin, LOW);
-	SPI.transfer(CmdBytes, 4);
-	digitalWrite(CSPin, HIGH);
-	waitForChip(60000);
-	SPI.endTransaction();
+	Tail = (WQHead + WQCount) % TEENSYDB_WRITEQUEUE;
 	
-}
-
-void TeensyDB::eraseSmallBlock(uint32_t BlockNumber){
-
-	Address = BlockNumber * SMALL_BLOCK_SIZE;
+	for (q = 0; q < Copy; q++){
+		WQUEUE[Tail] = (q < Pad) ? NULL_RECORD : Source[q - Pad];
+		Tail++;
+		if (Tail >= TEENSYDB_WRITEQUEUE){
+			Tail = 0;
+		}
+	}
 	
-	buildCommandBytes(CmdBytes, SMALLBLOCKERASE, Address);
-		
-	SPI.beginTransaction(SPISettings(SPEED_WRITE, MSBFIRST, SPI_MODE0));
-	digitalWrite(CSPin, LOW);
-	SPI.transfer(WRITEENABLE);
-	digitalWrite(CSPin, HIGH);
-
-	waitForChip(60000);
-
-	digitalWrite(CSPin, LOW);
-	SPI.transfer(CmdBytes, 4);
-	digitalWrite(CSPin, HIGH);
-	waitForChip(60000);
-	SPI.endTransaction();
+	WQCount = WQCount + Copy;
+	PendingRecords++;
 	
-}
-void TeensyDB::eraseLargeBlock(uint32_t BlockNumber){
-
-	Address = BlockNumber * LARGE_BLOCK_SIZE;
+	// summarize the sector, at its first record start over, otherwise pick up what's already on the chip
+	if (ZoneMap && (CurrentRecord > 0)){
+		if ((((CurrentRecord - 1) % RecordsPerSector) == 0) || (!ZoneLoaded) || (ZoneSector != ((CurrentRecord - 1) / RecordsPerSector))){
+			loadZone(CurrentRecord);
+		}
+		addZone(RECORD);
+		if ((CurrentRecord % RecordsPerSector) == 0){
+			queueZone();
+		}
+	}
 	
-	buildCommandBytes(CmdBytes, LARGEBLOCKERASE, Address);
-		
-	SPI.beginTransaction(SPISettings(SPEED_WRITE, MSBFIRST, SPI_MODE0));
-	digitalWrite(CSPin, LOW);
-	SPI.transfer(WRITEENABLE);
-	digitalWrite(CSPin, HIGH);
-
-	waitForChip(60000);
-
-	digitalWrite(CSPin, LOW);
-	SPI.transfer(CmdBytes, 4);
-	digitalWrite(CSPin, HIGH);
-	waitForChip(60000);
-	SPI.endTransaction();
+	if (WQCount > WQHighWater){
+		WQHighWater = WQCount;
+	}
 	
 }
 
-
-// get data
+void TeensyDB::programPage(bool Wait) {
 	
-uint8_t TeensyDB::getField(uint8_t Data, uint8_t Field){
-
-	Address = (CurrentRecord * RecordLength) + FieldStart[Field];
-	aBytes[0] = readByte();
+	// program from the head of the queue up to the end of the page (or end of queue)
+	// the chip wraps within a page so we must never cross a page boundary
+	uint16_t Length = Chip->PageSize - (WQAddress % Chip->PageSize);
+	uint16_t q = 0;
 	
-	return (uint8_t) aBytes[0];
-
-}
-
-int TeensyDB::getField(int Data, uint8_t Field){
-
-	Address = (CurrentRecord * RecordLength) + FieldStart[Field];
-	aBytes[0] = readByte();
-	aBytes[1] = readByte();
-	aBytes[2] = readByte();
-	aBytes[3] = readByte();
+	if (Length > WQCount){
+		Length = WQCount;
+	}
+	
+	// chip ignores a write enable while it's programming, an erase may be suspended for the page
+	if (!readyFor(WQAddress, Length, Wait)){
+		// the page goes out on a later poll
+		return;
+	}
+	
+	// the chip is free and everything that left the queue is on it
+	updateCheckpoint(false);
+	
+	// ring mode, clear the sector in front of us before the next program. the chip only takes
+	// one erase at a time, so one still running (or suspended) is finished first
+	if (EraseAhead){
+		EraseAhead = false;
+		finishErase();
+		Device->erase(ERASE_SECTOR, EraseAddress);
+		TEENSYDB_STAT(Stats.Erases++);
+		WriteState = WS_ERASE;
+		EraseStart = EraseAddress - (EraseAddress % Chip->SectorSize);
+		EraseLength = Chip->SectorSize;
+		EraseTimeout = Chip->SectorEraseTime;
+		EraseRun = micros();
+		if (!readyFor(WQAddress, Length, Wait)){
+			return;
+		}
+	}
+	
+	if (Length == 0){
+		return;
+	}
+	
+	// stage the page so it's one contiguous buffer, the queue may wrap
+	for (q = 0; q < Length; q++){
+		PBUF[q] = WQUEUE[WQHead];
+		WQHead++;
+		if (WQHead >= TEENSYDB_WRITEQUEUE){
+			WQHead = 0;
+		}
+	}
+	
+	// on a Teensy the page goes out by DMA, the device returns as soon as it's started
+	Device->program(WQAddress, PBUF, Length);
+	TEENSYDB_STAT(Stats.Programs++);
+	TEENSYDB_STAT(Stats.ProgramBytes += Length);
+	WriteState = WS_PROGRAM;
+	
+	WQAddress = WQAddress + Length;
+	WQCount = WQCount - Length;
+	Address = WQAddress;
+	
+	if (Wait){
+		finishProgram();
+	}
 	
-	return (int) ( (aBytes[0] << 24) | (aBytes[1] << 16) | (aBytes[2] << 8) | (aBytes[3]));
-
-}
-
-int16_t TeensyDB::getField(int16_t Data, uint8_t Field){
-
-	Address = (CurrentRecord * RecordLength) + FieldStart[Field];
-	aBytes[0] = readByte();
-	aBytes[1] = readByte();
-
-	return (int16_t) (aBytes[0] << 8) | (aBytes[1]);
-
-}
-
-uint16_t TeensyDB::getField(uint16_t Data, uint8_t Field){
-
-	Address = (CurrentRecord * RecordLength) + FieldStart[Field];
-	aBytes[0] = readByte();
-	aBytes[1] = readByte();
-
-	return (uint16_t) (aBytes[0] << 8) | (aBytes[1]);
-
 }
 
-int32_t TeensyDB::getField(int32_t Data, uint8_t Field){
-
-	Address = (CurrentRecord * RecordLength) + FieldStart[Field];
-	aBytes[0] = readByte();
-	aBytes[1] = readByte();
-	aBytes[2] = readByte();
-	aBytes[3] = readByte();
-
-	return (int32_t) ( (aBytes[0] << 24) | (aBytes[1] << 16) | (aBytes[2] << 8) | (aBytes[3]));
-
+void TeensyDB::finishProgram() {
+	
+	// an erase is left to readyFor / finishErase
+	if (WriteState != WS_PROGRAM){
+		return;
+	}
+	
+	waitForChip(Chip->ProgramTime, LATENCY_PROGRAM);
+	
+	WriteState = WS_IDLE;
+	
 }
 
-uint32_t TeensyDB::getField(uint32_t Data, uint8_t Field){
-
-	Address = (CurrentRecord * RecordLength) + FieldStart[Field];
-	aBytes[0] = readByte();
-	aBytes[1] = readByte();
-	aBytes[2] = readByte();
-	aBytes[3] = readByte();
-
-	return (uint32_t) ( (aBytes[0] << 24) | (aBytes[1] << 16) | (aBytes[2] << 8) | (aBytes[3]));
-
-}
+/*
 
-float TeensyDB::getField(float Data, uint8_t Field){
+erases in the background. eraseAsync only records the range, eraseStep starts the largest aligned erase that fits
+(64k, 32k, then a sector) whenever the chip is free, from poll() and the saves. a read or program that comes along
+while the chip is erasing goes through readyFor: on a chip with erase suspend (0x75 / 0x7A on the Winbond parts)
+the erase gets TEENSYDB_ERASESLICE us from when it started or was last resumed, then it's suspended, the read or
+program is done and the next eraseStep resumes it. so a save waits for at most a slice, the suspend and its own
+program instead of a whole 45 ms sector or 150 ms block erase, and the slice makes sure the erase still gets
+somewhere when the saves never stop. the block being erased can't be read or programmed, anything there waits
+for the erase. chips without suspend in their profile wait, the same as before. ring mode's erase ahead goes
+through here too, a chip erase never does (it can't be suspended)
 
-	float f;
+*/
 
-	Address = (CurrentRecord * RecordLength) + FieldStart[Field];
+bool TeensyDB::eraseAsync(uint32_t StartSector, uint32_t Sectors) {
 	
-	aBytes[0] = readByte();
-	aBytes[1] = readByte();
-	aBytes[2] = readByte();
-	aBytes[3] = readByte();	
-
-	memcpy(&f, &aBytes, sizeof(f));
-	return f;
+	if ((EraseNext < EraseEnd) || (Sectors == 0) || ((StartSector + Sectors) > (Chip->Capacity / Chip->SectorSize))){
+		return false;
+	}
+	
+	// keep the order of operations, anything pending is written before the erase
+	flush();
+	
+	EraseNext = StartSector * Chip->SectorSize;
+	EraseEnd = EraseNext + (Sectors * Chip->SectorSize);
+	
+	eraseStep();
+	
+	return true;
 	
 }
 
-double TeensyDB::getField(double Data, uint8_t Field){
-    double d;
-	Address = (CurrentRecord * RecordLength) + FieldStart[Field];
-	aBytes[0] = readByte();
-	aBytes[1] = readByte();
-	aBytes[2] = readByte();
-	aBytes[3] = readByte();	
-	aBytes[4] = readByte();
-	aBytes[5] = readByte();
-	aBytes[6] = readByte();
-	aBytes[7] = readByte();
+uint32_t TeensyDB::getErasePending() {
+	
+	return ((EraseEnd - EraseNext) + EraseLength) / Chip->SectorSize;
 	
-	memcpy(&d, &aBytes, sizeof(d));
-	return d;
 }
 
-char  *TeensyDB::getCharField(uint8_t Field){
+bool TeensyDB::readyFor(uint32_t Address, uint32_t Length, bool Wait) {
 	
-	int8_t bytes[FieldLength[Field]+1];
+	finishProgram();
 	
-	Address = (CurrentRecord * RecordLength) + FieldStart[Field];
-	for (i = 0; i < FieldLength[Field];i++){
-		bytes[i] = readByte();
-		if (bytes[i] == '\0'){
-			break;
-		}		
+	if (EraseLength == 0){
+		return true;
 	}
 	
-	memset(stng,0,FieldLength[Field]+1);
+	// the block being erased has to wait for the erase
+	if ((Address < (EraseStart + EraseLength)) && ((Address + Length) > EraseStart)){
+		if (!Wait){
+			return false;
+		}
+		finishErase();
+		return true;
+	}
 	
-	memcpy(stng, bytes, FieldLength[Field]);
-	//stng[sizeof(bytes)] = '\0';
-	return stng;
-
-}
-
-uint32_t TeensyDB::getCurrentRecord(){
-	return CurrentRecord;
+	if ((WriteState == WS_ERASE) && (!suspendErase(Wait))){
+		if (!Wait){
+			return false;
+		}
+		finishErase();
+	}
 	
-}
-
-uint32_t TeensyDB::getLastRecord(){
-	return LastRecord;
-}
-
-void TeensyDB::setAddress(uint32_t Address){
-	Address = Address;
+	return true;
 	
 }
 
-uint32_t TeensyDB::getAddress(){
-	return Address;
+bool TeensyDB::suspendErase(bool Wait) {
 	
-}
-
-void TeensyDB::gotoRecord(uint32_t RecordNumber){
+	bool Done = false;
 	
-	if (RecordNumber > MaxRecords){
-		CurrentRecord = MaxRecords;
+	if (Chip->SuspendCmd == 0x00){
+		return false;
 	}
-	else {
-		CurrentRecord = RecordNumber;
+	
+	// the erase gets its slice first, it may finish in the meantime
+	Done = Device->isReady();
+	while ((!Done) && ((micros() - EraseRun) < TEENSYDB_ERASESLICE)){
+		if (!Wait){
+			return false;
+		}
+		Done = Device->isReady();
 	}
 	
-	Address = (CurrentRecord + 1)  * RecordLength;
-
-}
-
-bool TeensyDB::saveRecord() {
+	WriteState = WS_IDLE;
 	
-	for (i= 0; i < FieldCount; i++){		
-
-		if (DataType[i] == DT_U8){		
-			RECORD[FieldStart[i]] = *u8data[i];
-		}
-		else if (DataType[i] == DT_INT){			
-			RECORD[FieldStart[i]] = (uint8_t) (*intdata[i] >> 24);
-			RECORD[FieldStart[i]+1] = (uint8_t) (*intdata[i] >> 16);
-			RECORD[FieldStart[i]+2] = (uint8_t) (*intdata[i] >> 8);
-			RECORD[FieldStart[i]+3] = (uint8_t) (*intdata[i]);			
-		}
-		else if (DataType[i] == DT_I16){			
-			RECORD[FieldStart[i]] = (uint8_t) (*i16data[i] >> 8);
-			RECORD[FieldStart[i]+1] = (uint8_t) (*i16data[i]);
-		}
-		else if (DataType[i] == DT_U16){			
-			RECORD[FieldStart[i]] = (uint8_t)(*u16data[i]  >> 8 );
-			RECORD[FieldStart[i]+1] = (uint8_t) *u16data[i];
-		}
-		else if (DataType[i] == DT_I32){			
-			RECORD[FieldStart[i]] = (uint8_t) (*i32data[i] >> 24);
-			RECORD[FieldStart[i]+1] = (uint8_t) (*i32data[i] >> 16);
-			RECORD[FieldStart[i]+2] = (uint8_t) (*i32data[i] >> 8);
-			RECORD[FieldStart[i]+3] = (uint8_t) (*i32data[i]);
-		}
-		else if (DataType[i] == DT_U32){			
-			RECORD[FieldStart[i]] = (uint8_t) (*u32data[i] >> 24);
-			RECORD[FieldStart[i]+1] = (uint8_t) (*u32data[i] >> 16);
-			RECORD[FieldStart[i]+2] = (uint8_t) (*u32data[i] >> 8);
-			RECORD[FieldStart[i]+3] = (uint8_t) (*u32data[i]);
-		}
-		else if (DataType[i] == DT_FLOAT){	
-			memcpy(aBytes, (void *)fdata[i], FieldLength[i]);			
-			for (q = 0; q < FieldLength[i]; q++){
-				RECORD[FieldStart[i]+q] = aBytes[q];
-			}			
-		}	
-		else if (DataType[i] == DT_DOUBLE){				
-			memcpy(aBytes, (void*)ddata[i], FieldLength[i]);
-			for (q = 0; q < FieldLength[i]; q++){
-				RECORD[FieldStart[i]+q] = aBytes[q];
-			}	
-		}
-		else if (DataType[i] == DT_CHAR){				
-			strcpy(buf,cdata[i]);			
-			for (q = 0; q < strlen(buf); q++){
-				RECORD[FieldStart[i]+q] = buf[q];
-			}
-			RECORD[FieldStart[i]+q] = '\0';
-		}	
-	}
-	/*
-	for (q = 0; q < RecordLength; q++){
-		Serial.print(RECORD[q]);
-		Serial.print("-");
+	if (Done){
+		EraseLength = 0;
+		return true;
 	}
-	Serial.println();
-	*/
-	writeRecord();
-		
-	return true;
 	
-}
-
-uint8_t TeensyDB::readByte() {
+	if (!Device->suspend()){
+		WriteState = WS_ERASE;
+		return false;
+	}
+	TEENSYDB_STAT(Stats.Suspends++);
+	EraseSuspended = true;
 	
-
-	buildCommandBytes(CmdBytes, READ, Address);
-	SPI.beginTransaction(SPISettings(SPEED_READ, MSBFIRST, SPI_MODE0));
-
-		
-	digitalWrite(CSPin, LOW);
-	SPI.transfer(CmdBytes, 4);
-	readvalue = SPI.transfer(0x00);
-	digitalWrite(CSPin, HIGH);
+	// data sheet time is in us, waitReady wants ms
+	if (!Device->waitReady((Chip->SuspendTime / 1000) + 1)){
+		TEENSYDB_STAT(Stats.Timeouts++);
+	}
 	
-	SPI.endTransaction();  
-
-	waitForChip(50);
-
-	// since we are reading byte by byte we need to advance address
-	// reading byte arrays is unreliable
-	Address = Address + 1;
+	return true;
 	
-	return readvalue;
-  
 }
 
-void TeensyDB::waitForChip(uint32_t Wait) {
+void TeensyDB::finishErase() {
 	
-	timeout = millis();
-	uint8_t Status = 0x01;
+	finishProgram();
 	
-	while (Status & STAT_WIP){	
-		
-		digitalWrite(CSPin, LOW);
-		//delayMicroseconds(5);
-		SPI.transfer(CMD_READ_STATUS_REG);
-		Status = SPI.transfer(0x00);
-		digitalWrite(CSPin, HIGH);
-		//delayMicroseconds(5);
-		if ((millis() - timeout) > Wait) return; // timeout
+	if (EraseSuspended){
+		Device->resume();
+		TEENSYDB_STAT(Stats.Resumes++);
+		EraseSuspended = false;
+		WriteState = WS_ERASE;
 	}
 	
-
-}
-
-void TeensyDB::buildCommandBytes(uint8_t *buf, uint8_t cmd, uint32_t addr) {
-	buf[0] = cmd;
-	buf[1] = addr >> 16;
-	buf[2] = addr >> 8;
-	buf[3] = addr;
-
+	if (WriteState == WS_ERASE){
+		waitForChip(EraseTimeout, LATENCY_ERASE);
+		WriteState = WS_IDLE;
+	}
+	
+	EraseLength = 0;
+	
 }
 
-void TeensyDB::writeRecord() {
-		
- 	Address = CurrentRecord * RecordLength;
-
-	// we start writing at 0 byte of current record
-	// then we write in sequence RecordLength bytes
+void TeensyDB::eraseStep() {
 	
-	uint8_t i = 0, LastByte = RecordLength;
-	bool PageSpan = false;
-	pageOffset = Address % PAGE_SIZE;
+	uint8_t Type = ERASE_SECTOR;
+	uint32_t Length = Chip->SectorSize;
+	uint32_t Timeout = Chip->SectorEraseTime;
 	
-	if ((pageOffset + RecordLength) > PAGE_SIZE){
-		PageSpan = true;		
-		LastByte = PAGE_SIZE - pageOffset;
+	if ((WriteState == WS_ERASE) && Device->isReady()){
+		WriteState = WS_IDLE;
+		EraseLength = 0;
 	}
-
-	SPI.beginTransaction(SPISettings(SPEED_WRITE, MSBFIRST, SPI_MODE0));
 	
-	digitalWrite(CSPin, LOW);
-	SPI.transfer(WRITEENABLE);
-	digitalWrite(CSPin, HIGH); 
-
-	waitForChip(50);
-
-	digitalWrite(CSPin, LOW);	
-	SPI.transfer(WRITE);	
-	SPI.transfer((uint8_t) ((Address >> 16) & 0xFF));
-	SPI.transfer((uint8_t) ((Address >> 8) & 0xFF));
-	SPI.transfer((uint8_t) (Address & 0xFF));	
+	if (WriteState != WS_IDLE){
+		return;
+	}
 	
-	for (i = 0; i < LastByte; i++){
-		SPI.transfer(RECORD[i]);	
-		Address++;		
+	if (EraseSuspended){
+		Device->resume();
+		TEENSYDB_STAT(Stats.Resumes++);
+		EraseSuspended = false;
+		WriteState = WS_ERASE;
+		EraseRun = micros();
+		return;
 	}
-	 
-	digitalWrite(CSPin, HIGH); 
-		
-	waitForChip(50);
 	
-	SPI.endTransaction();	
-
-	if (!PageSpan){
-		Address = Address + RecordLength;
+	EraseLength = 0;
+	
+	if (EraseNext >= EraseEnd){
 		return;
 	}
-	SPI.beginTransaction(SPISettings(SPEED_WRITE, MSBFIRST, SPI_MODE0));
-	digitalWrite(CSPin, LOW);
-	SPI.transfer(WRITEENABLE);
-	digitalWrite(CSPin, HIGH); 
-
-	waitForChip(50);
-
-	digitalWrite(CSPin, LOW);	
-	SPI.transfer(WRITE);	
-	SPI.transfer((uint8_t) ((Address >> 16) & 0xFF));
-	SPI.transfer((uint8_t) ((Address >> 8) & 0xFF));
-	SPI.transfer((uint8_t) (Address & 0xFF));	
 	
-	for (i = LastByte; i < RecordLength; i++){
-		SPI.transfer(RECORD[i]);
-		Address++;		
+	// the largest aligned erase that fits in what's left
+	if (((EraseNext % Chip->LargeBlockSize) == 0) && ((EraseEnd - EraseNext) >= Chip->LargeBlockSize)){
+		Type = ERASE_LARGEBLOCK;
+		Length = Chip->LargeBlockSize;
+		Timeout = Chip->LargeBlockEraseTime;
 	}
-	 
-	digitalWrite(CSPin, HIGH); 
-	waitForChip(50);
-	SPI.endTransaction();	
+	else if ((Chip->SmallBlockEraseCmd != 0x00) && ((EraseNext % Chip->SmallBlockSize) == 0) && 
+		((EraseEnd - EraseNext) >= Chip->SmallBlockSize)){
+		Type = ERASE_SMALLBLOCK;
+		Length = Chip->SmallBlockSize;
+		Timeout = Chip->SmallBlockEraseTime;
+	}
+	
+	Device->erase(Type, EraseNext);
+	TEENSYDB_STAT(Stats.Erases++);
+	WriteState = WS_ERASE;
+	EraseStart = EraseNext;
+	EraseLength = Length;
+	EraseTimeout = Timeout;
+	EraseRun = micros();
+	EraseNext = EraseNext + Length;
+	
+	RecordCached = false;
+	
+}
 
+bool TeensyDB::isPending(uint32_t StartAddress, uint32_t Length) {
+	
+	// true if any of the bytes are still in the write queue and not on the chip
+	if (WQCount == 0){
+		return false;
+	}
+	
+	return (StartAddress < (WQAddress + WQCount)) && ((StartAddress + Length) > WQAddress);
+	
 }
 
 //////////////////////////////////////////////////////////
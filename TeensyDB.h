@@ -0,0 +1,1047 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+  
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library 
+  and make millions of dollars, I'm happy for you!
+
+	rev		date			author				change
+	1.0		2/2022			kasprzak			initial code
+	2.0		1/2024			kasprzak			code cleanup
+	2.5		8/2024			kasprzak			Optimized write time by writing full record as oppposed to byte by byte
+	
+	This library has been tested with
+	MCU
+	Teensy 3.2
+	Teensy 4.0
+	
+	Flash Chips
+	Microchip		SST25F040C
+	Winbond 		25Q64JVSIQ
+	
+	this library is a database driver for the hardware listed above. The chip is identified by its JEDEC ID at init()
+	and sizes, timing and instruction codes come from the chip profile table in TeensyDBChip.cpp. Other flash chips
+	can be added to that table or passed in with setChipProfile()
+
+
+*/
+
+#ifndef TEENSYDB_H
+#define TEENSYDB_H
+
+#if ARDUINO >= 100
+	 #include "Arduino.h"
+	 #include "Print.h"
+#else
+	 // building on a PC against the simulated chip, see extras/host
+	 #include "TeensyDBHost.h"
+#endif
+
+#ifdef __cplusplus
+	
+#endif
+
+#include "TeensyDBDevice.h"
+
+#define TEENSYDB_VERSION 2.5
+
+// limits, the defaults suit most loggers. they size arrays in every TeensyDB object so raise them with build flags
+// (-DMAX_FIELDS=80 -DTEENSYDB_MAXREXORDLENGTH=512 for a 64 channel logger, build_flags in PlatformIO) rather than
+// editing this file. the Arduino IDE can't pass flags to a library, there change the defaults below
+#ifndef MAX_FIELDS
+#define MAX_FIELDS 20 // field numbers are 1 based, so MAX_FIELDS - 1 fields (up to 255)
+#endif
+#ifndef TEENSYDB_MAXREXORDLENGTH
+#define TEENSYDB_MAXREXORDLENGTH 100 // longest record, bytes (up to 8191)
+#endif
+#ifndef TEENSYDB_MAXDATACHARLEN
+#define TEENSYDB_MAXDATACHARLEN (TEENSYDB_MAXREXORDLENGTH + 1) // longest string getCharField returns + 1
+#endif
+#ifndef TEENSYDB_SCANBUFFER
+#define TEENSYDB_SCANBUFFER 2048 // bytes per half of the scan double buffer
+#endif
+#define TEENSYDB_NAMELENGTH 16 // longest field name + 1
+#define TEENSYDB_EXTENTINDEX 64 // sectors of a table remembered, the rest are found from these
+#ifndef TEENSYDB_WRITEQUEUE
+#define TEENSYDB_WRITEQUEUE 1024 // bytes of encoded records waiting to be programmed
+#endif
+#define TEENSYDB_RINGCHECKPOINT 32 // checkpoint interval ring mode uses if none was set
+#define TEENSYDB_KEYINDEX 256 // entries in the key index (8 bytes each)
+#define TEENSYDB_BLOCKINDEX 256 // entries in the compressed block index (4 bytes each)
+#define TEENSYDB_NOBLOCK 0xFFFFFFFF
+#define TEENSYDB_COMMIT 0xA5 // last byte of a record with a record check
+#define PAGE_SIZE 256 // largest page size supported
+#define TEENSYDB_HISTOGRAM 24 // log2 latency buckets, the last one holds anything over 4 s
+#ifndef TEENSYDB_ERASESLICE
+#define TEENSYDB_ERASESLICE 1000 // us an erase runs (after it starts or resumes) before a read or program can suspend it
+#endif
+
+// hot path counters and latency histograms (see getStats), build with -DTEENSYDB_NO_STATS to take them out
+#ifndef TEENSYDB_NO_STATS
+#define TEENSYDB_STAT(Statement) Statement
+#else
+#define TEENSYDB_STAT(Statement)
+#endif
+
+#if MAX_FIELDS > 255
+#error "MAX_FIELDS can't be over 255, field numbers are uint8_t"
+#endif
+#if TEENSYDB_MAXREXORDLENGTH > 8191
+#error "TEENSYDB_MAXREXORDLENGTH can't be over 8191, bit positions are uint16_t"
+#endif
+#if (TEENSYDB_MAXREXORDLENGTH > TEENSYDB_SCANBUFFER) || (TEENSYDB_MAXREXORDLENGTH > TEENSYDB_WRITEQUEUE)
+#error "TEENSYDB_SCANBUFFER and TEENSYDB_WRITEQUEUE must hold at least one record"
+#endif
+
+// defaults for a chip that is not in the profile table (TeensyDBChip.cpp)
+#define CARD_SIZE 8388608 // 32768 pages x 256
+#define SECTOR_SIZE 4096
+#define LARGE_BLOCK_SIZE 65536
+#define SMALL_BLOCK_SIZE 32768
+// fastest the board wiring allows, the chip's own limit comes from its profile
+#define SPEED_WRITE      25000000
+#define SPEED_READ       25000000
+
+// chip instruction codes
+#define NULL_RECORD 	0xFF
+#define WRITEENABLE   	0x06
+#define WRITE         	0x02
+#define READ          	0x03
+#define FASTREAD        0x0B
+#define CMD_READ_STATUS_REG    0x05
+#define SMALLBLOCKERASE 0x52
+#define LARGEBLOCKERASE 0xD8
+#define SECTORERASE   	0x20
+#define CHIPERASE     	0x60
+#define JEDEC         	0x9F
+#define UNIQUEID     	0x4B
+#define STAT_WIP 			   0x01
+//
+//
+// end of chip specific settings
+/////////////////////////////////////////////////////////
+
+#define DT_U8 	1
+#define DT_INT 	2
+#define DT_I16 	3
+#define DT_U16 	4
+#define DT_I32 	5
+#define DT_U32 	6
+#define DT_FLOAT 7
+#define DT_DOUBLE 8
+#define DT_CHAR 9
+#define DT_UINT 10
+#define DT_BITS8 11
+#define DT_BITS16 12
+#define DT_BITS32 13
+#define DT_SCALED 14
+
+// latency histograms in TeensyDBStats
+#define LATENCY_SAVE 0 // saveRecord
+#define LATENCY_SAVEASYNC 1 // saveRecordAsync
+#define LATENCY_WRITE 2 // writeRecord, saveRecord less the encoding
+#define LATENCY_PROGRAM 3 // waiting on a page program
+#define LATENCY_ERASE 4 // waiting on an erase
+#define LATENCY_FIND 5 // findFirstWritableRecord
+#define LATENCY_COUNT 6
+
+#define WS_IDLE 0
+#define WS_PROGRAM 1
+#define WS_ERASE 2
+
+#define CHIP_NEW 0
+#define CHIP_INVALID -1
+#define CHIP_FULL -2
+#define CHIP_FORCE_RESTART -3
+#define NO_FIELDS -4
+#define SCHEMA_MISMATCH -5
+#define NO_SCHEMA -6
+
+// callback used by scan, return false to stop the scan early
+typedef bool (*TeensyDBScanCallback)(uint32_t Record);
+
+// statistics for a field, returned by aggregate
+struct TeensyDBAggregate {
+	uint32_t Count;
+	double Min;
+	double Max;
+	double Sum;
+	double Mean;
+	double StdDev; // sample standard deviation
+};
+
+// how long one operation took, Bucket[0] is under 1 us and Bucket[n] is 2^(n-1) to 2^n - 1 us
+struct TeensyDBHistogram {
+	uint32_t Count;
+	uint32_t Max; // us
+	uint32_t Bucket[TEENSYDB_HISTOGRAM];
+};
+
+// what the chip was asked to do since init or resetStats, returned by getStats
+struct TeensyDBStats {
+	uint32_t Transactions; // reads + programs + erases + status polls + suspends and resumes (write enables not counted)
+	uint32_t Reads;
+	uint32_t ReadBytes;
+	uint32_t Programs;
+	uint32_t ProgramBytes;
+	uint32_t Erases;
+	uint32_t StatusPolls;
+	uint32_t Timeouts; // waits on the chip that gave up, what was being written may not be there
+	uint32_t Suspends; // erases suspended for a read or program
+	uint32_t Resumes;
+	TeensyDBHistogram Latency[LATENCY_COUNT]; // LATENCY_SAVE ... LATENCY_FIND
+};
+
+class TeensyDB;
+
+// a view of one record where it sits in the read buffer (or the scan buffer inside a scan callback), fields are
+// decoded straight from those bytes when asked for, nothing is copied. the view is good until the next read
+// (gotoRecord, getField of another record, readRecord, the next record of a scan), get a new one after that
+class TeensyDBRecord {
+
+public:
+
+	TeensyDBRecord() : DB(NULL), Bytes(NULL) {}
+	TeensyDBRecord(TeensyDB *UserDB, const uint8_t *UserBytes) : DB(UserDB), Bytes(UserBytes) {}
+	
+	// false if there was no such record or it failed the record check, don't get fields from it then
+	bool isValid() const { return Bytes != NULL; }
+	
+	// the encoded record, getRecordLength bytes
+	const uint8_t *getBytes() const { return Bytes; }
+	
+	// same overloads as TeensyDB::getField
+	uint8_t getField(uint8_t Data, uint8_t Field) const;
+#ifndef TEENSYDB_NO_INT_OVERLOAD
+	int getField(int Data, uint8_t Field) const;
+#endif
+	int16_t getField(int16_t Data, uint8_t Field) const;
+	uint16_t getField(uint16_t Data, uint8_t Field) const;
+	int32_t getField(int32_t Data, uint8_t Field) const;
+	uint32_t getField(uint32_t Data, uint8_t Field) const;
+	float getField(float Data, uint8_t Field) const;
+	double getField(double Data, uint8_t Field) const;
+	
+	// char fields are not copied, this points at the text in the record and Length is set to the length of it
+	// the text is only 0 terminated if it is shorter than the field, so use Length (Serial.write(Text, Length))
+	const char *getCharField(uint8_t Field, uint16_t &Length) const;
+	
+	// any numeric field as a double, like TeensyDB::getFieldValue
+	double getFieldValue(uint8_t Field) const;
+
+private:
+
+	TeensyDB *DB;
+	const uint8_t *Bytes;
+	
+	bool isBitField(uint8_t Field) const;
+	
+};
+
+// class constructor
+class  TeensyDB {
+		
+public:
+
+#ifdef ARDUINO
+	// just need the chip select for the flash chip, make sure pin supports fast chip select writing
+	TeensyDB(int CS_PIN);
+#endif
+	
+	// or bring your own bus, for example a different SPI port
+	TeensyDB(TeensyDBBus &UserBus);
+	
+	// or bring your own device, for example the simulated chip in extras/host
+	TeensyDB(TeensyDBDevice &UserDevice);
+	
+	// must call to initiate some settings
+	bool init();
+	
+	// call as many as you need to establish the field list
+	// fields can be in any order, but max field count is MAX_FIELDS - 1 and the record can't be longer than
+	// TEENSYDB_MAXREXORDLENGTH (and with setSchema, the schema block has to hold the list), addField returns 0 if the
+	// field doesn't fit
+	// WARNING.... if your added fields don't match the field list on the chip
+	// reading and writing will be corrupted
+	// if you change field list you myst erase your chip (or use setSchema and the chip will refuse the new list)
+	uint8_t addField(uint8_t *Data);	
+#ifndef TEENSYDB_NO_INT_OVERLOAD
+	uint8_t addField(int *Data);
+#endif
+	uint8_t addField(int16_t *Data);
+	uint8_t addField(uint16_t *Data);
+	uint8_t addField(uint32_t *Data);
+	uint8_t addField(int32_t *Data);
+	uint8_t addField(float *Data);
+	uint8_t addField(double *Data);
+	uint8_t addField(char  *Data, uint16_t len);
+	
+	// methods to add a field that only takes the bits it needs, packed with the other bit fields
+	// uint16_t ADC; ADCID = SSD.addBitField(&ADC, 12);
+	uint8_t addBitField(bool *Data);
+	uint8_t addBitField(uint8_t *Data, uint8_t Bits);
+	uint8_t addBitField(uint16_t *Data, uint8_t Bits);
+	uint8_t addBitField(uint32_t *Data, uint8_t Bits);
+	
+	// method to add a float stored as Offset + a Bits bit count of Scale steps, read it back with getField(float)
+	// -40.0 to 85.0 in 0.1 steps: TempID = SSD.addScaledField(&Temp, 0.1, -40.0, 11);
+	uint8_t addScaledField(float *Data, float Scale, float Offset, uint8_t Bits);
+	
+	// method used to determine the first writable record and where the next record can begin
+	// this function uses bisectional seeking to determine the end
+	// the function relies on the field list being first established
+	uint32_t findFirstWritableRecord();
+	
+	// method to keep the field list and settings in the first sector of the chip. findFirstWritableRecord writes it
+	// to a new chip and returns SCHEMA_MISMATCH (and nothing can be saved) if the chip was written with other fields
+	// call after init and before findFirstWritableRecord, the same way every time. the schema holds up to
+	// (TEENSYDB_SCANBUFFER - 16) / 16 fields (127), false if more were added already, addField turns them away after
+	bool setSchema(bool Enable);
+	
+	// method to read the field list and settings from a chip written with setSchema, call after init instead of
+	// adding fields. returns the field count or NO_SCHEMA, the chip can then be read but not written
+	int16_t loadSchema();
+	
+	// methods to name a field (stored in the schema, up to 15 characters) and to read the names and types back
+	void setFieldName(uint8_t Field, const char *Name);
+	const char *getFieldName(uint8_t Field);
+	uint8_t getFieldType(uint8_t Field);
+	
+	// method to get any numeric field of the current record as a double, handy after loadSchema
+	double getFieldValue(uint8_t Field);
+	
+	// method to make this object table Number (1 to 254) of the chip, each table has its own fields and sectors so
+	// fast and slow data can be logged with different records and read back separately. use one object per table
+	// and call after init and before anything else, the same way every time. see the tables notes in TeensyDB.cpp
+	bool setTable(uint8_t Number);
+	uint8_t getTable();
+	
+	// method to get how many sectors the table has (including the one with its schema)
+	uint32_t getTableSectors();
+	
+	// method to end every record with a CRC-16 and a commit marker (3 bytes) so a record cut off by a power loss
+	// is caught instead of read as data. call after the fields are added, the same way every time
+	bool setRecordCheck(bool Enable);
+	
+	// method to check the current record, false if it failed the record check (getField returns 0 for it)
+	bool isRecordValid();
+	
+	// method to get how many bad records were found, the torn last record at boot or every one by verifyRecords
+	// getField, scan and aggregate skip bad records but don't count them, so reading one twice doesn't count twice
+	uint32_t getBadRecords();
+	
+	// method to read every record once and count the ones that fail the record check, returns getBadRecords()
+	uint32_t verifyRecords();
+	
+	// method to keep a checkpoint of the last saved record so findFirstWritableRecord finds the end of the data with
+	// a few reads instead of searching the chip. a checkpoint is written every Interval records (0 is off, the default)
+	// the first 2 sectors of the chip (after the schema) are reserved for checkpoints, so call this before findFirstWritableRecord and
+	// the same way every time, a chip written with checkpoints can't be read without them (and the other way round)
+	void setCheckpoint(uint16_t Interval);
+	
+	// method to write a checkpoint now, say before powering down
+	bool checkpoint();
+	
+	// method to get the record number in the newest checkpoint
+	uint32_t getCheckpointRecord();
+	
+	// method to log in a ring, when the chip is full the oldest sector is reused instead of addRecord failing
+	// the sector ahead of the write head is erased in the background so saves never wait on a full chip erase
+	// ring mode uses checkpoints (turned on if they are not), call before findFirstWritableRecord and the same
+	// way every time. start with an erased chip
+	void setRingMode(bool Enable);
+	
+	// method to get the oldest record still on the chip, always 1 unless ring mode has wrapped around
+	uint32_t getFirstRecord();
+	
+	// method used to go to the last record, the address is pointing to the beginning of the last valid record
+	uint32_t gotoLastRecord();
+	
+	// method to get the manufacture JEDEC codes
+	char *getChipJEDEC();
+	
+	// method to get the name of the chip profile picked at init() ("GENERIC" if the chip is not in the table)
+	const char *getChipName();
+	
+	// methods to get or replace the chip profile (size, timing, instruction codes)
+	// call setChipProfile after init() for a chip that is not in the table, page size can't exceed PAGE_SIZE
+	const TeensyDBChipProfile *getChipProfile();
+	void setChipProfile(const TeensyDBChipProfile &Profile);
+	
+	// method to read on 2 (dual output) or 4 (quad output) data lines, call after init()
+	// needs a bus that can do it (TeensyDBBitBangBus) and a chip profile with the dual / quad read codes
+	// returns the number of lines actually used, 1 if neither can. the bit bang bus is slower than the SPI port
+	// (see TeensyDBBitBangBus). 4 sets the chip's quad enable bit, which is non volatile: the chip's WP and HOLD
+	// pins stay IO2 and IO3 from then on, even after a power cycle
+	uint8_t setReadLanes(uint8_t Lanes);
+	
+	void getUniqueID(uint8_t *ByteID);
+	
+	// method to return the current address, mainly for debugging, and really should never be needed
+	// this library is intended to be a record based (goto record x and read field y) and not have to worry about the address
+	uint32_t getAddress();
+	
+	// method to go to a desired record, error checking if you goto 0 or past last record
+	// first call to get data from a field, first goto a record the use getField to retrieve saved data
+	void gotoRecord(uint32_t Record);
+	
+	// method to return where you are at, can be used in printing operations, where you get the current record, then
+	// print other records, the you can return to that current record
+	uint32_t getCurrentRecord();
+	
+	
+	uint32_t getLastRecord();
+	
+	// method to just erase a portion of the chip
+	// I recommend proceeding with caution with this call
+	// if you erase just a portion of the data in the middle of a large data set
+	// you will most likely NOT be able to successfully write new data
+	// at startup a bisectional seek is used to find the last record. any breaks
+	// in th data will break seeking and return a record that is NOT at the end
+	// meaning you will probably write over existing data that will corrupt that data
+	void eraseSector(uint32_t SectorNumber);
+	
+	// method to just erase a portion of the chip
+	// I recommend proceeding with caution with this call
+	// if you erase just a portion of the data in the middle of a large data set
+	// you will most likely NOT be able to successfully write new data
+	// at startup a bisectional seek is used to find the last record. any breaks
+	// in th data will break seeking and return a record that is NOT at the end
+	// meaning you will probably write over existing data that will corrupt that data
+	void eraseSmallBlock(uint32_t BlockNumber);
+	
+	// method to just erase a portion of the chip
+	// I recommend proceeding with caution with this call
+	// if you erase just a portion of the data in the middle of a large data set
+	// you will most likely NOT be able to successfully write new data
+	// at startup a bisectional seek is used to find the last record. any breaks
+	// in th data will break seeking and return a record that is NOT at the end
+	// meaning you will probably write over existing data that will corrupt that data
+	void eraseLargeBlock(uint32_t BlockNumber);
+	
+	// method to...you guessed it... erase the entire chip
+	// by far the safest but can take 20 seconds
+	void eraseAll();
+	
+	// method to erase sectors in the background, Sectors of them from StartSector on. the largest aligned erase
+	// that fits (64k, 32k or a sector) is started whenever the chip is free, from poll() and the saves. on a chip
+	// that can suspend an erase (see its profile) a read or a program waits at most TEENSYDB_ERASESLICE us and the
+	// suspend time, on others they wait for the erase. false if a range is still pending or it's off the chip
+	// the same caution as eraseSector applies
+	bool eraseAsync(uint32_t StartSector, uint32_t Sectors);
+	
+	// method to see how many sectors are still to be erased, counting any being erased now
+	uint32_t getErasePending();
+	
+	// method to add a new record, must be called before save record
+	// it will be called automatically if saveRecord called w/o new record
+	// included a manual way as it's a typical workflow
+	// add rec does nothign more that move the last address by the record length
+	bool addRecord();
+
+	// method to save all set fields to their location in a new record
+	// there are no provisions to save over a record. these flash chips will only write to 
+	// unwritten addresses (0xFF)
+	// save record looks at the datas pointers, so there are no need to pass in data
+	bool saveRecord();
+	
+	// method to turn on write combining, saved records are held in RAM and only
+	// programmed once a full page is ready, which is much faster for short records
+	// FlushRecords and FlushTime (ms) limit how much data is at risk on a power loss
+	// the queue is flushed once either is reached, 0 disables that limit
+	// only checked when a record is saved or poll() is called, so call flush() when logging stops
+	void setWriteCombine(bool Enable, uint16_t FlushRecords = 0, uint32_t FlushTime = 0);
+	
+	// method to write any records waiting in the write queue to the chip
+	// an erase (eraseAsync or ring mode) is left running, poll() until isBusy() is false before powering down
+	bool flush();
+	
+	// method to save a record without waiting on the chip, the record is queued and a page
+	// program is started if the chip is idle. call poll() often (every pass of loop) to keep
+	// the queue moving. it only waits on the chip if the write queue is full
+	bool saveRecordAsync();
+	
+	// methods to save a record that is already laid out (Length bytes, fields in order, as TeensyDBTable does),
+	// the record check is added here. false if Length isn't getDataLength()
+	bool saveRecord(const uint8_t *Bytes, uint16_t Length);
+	bool saveRecordAsync(const uint8_t *Bytes, uint16_t Length);
+	
+	// method to get the bytes of a record without moving to it, NULL if there is no such record (or ring mode has
+	// written over it) or it failed the record check. the bytes are good until the next read
+	const uint8_t *readRecord(uint32_t Record);
+	
+	// methods to get a view of a record, fields are read from it without copies (see TeensyDBRecord)
+	// the first is the current record, inside a scan callback that is the record in the scan buffer
+	// the second reads a record without moving to it, like readRecord
+	// for example:
+	// TeensyDBRecord Reading = SSD.getRecord(i);
+	// if (Reading.isValid()) {
+	//   Plot(Reading.getField(MyVolts, MyVoltsID));
+	// }
+	TeensyDBRecord getRecord();
+	TeensyDBRecord getRecord(uint32_t Record);
+	
+	// method to get the counters and latency histograms (times are from micros()), for example the worst
+	// saveRecord is getStats().Latency[LATENCY_SAVE].Max. all 0 if built with -DTEENSYDB_NO_STATS
+	TeensyDBStats getStats();
+	void resetStats();
+	
+	// method to move the async write queue along, never waits on the chip
+	// returns true while there is still work in progress
+	bool poll();
+	
+	// method to see if records are still queued, a program is in progress or an erase is pending
+	bool isBusy();
+	
+	// methods to see how full the write queue is (bytes)
+	// the high water mark is the most the queue has held, handy for sizing TEENSYDB_WRITEQUEUE
+	uint16_t getQueueDepth();
+	uint16_t getQueueHighWater();
+	void resetQueueHighWater();
+	
+	// method to dump the field list to the serial monitor. it will dump based on the set field list
+	// mainly for debugging, no known practical use	
+	void listFields();
+	
+	// method to get the count of the set fields
+	// ideal for printing the field names and field data
+	// for example:
+	// for i = 1 to max records
+	//   for j = 1 to max fields
+	//     printfield(j)
+	//   next field
+	// next record
+	uint8_t getFieldCount();
+	
+	// menthod to get the field length so you can print it to some type of report
+	// not really a practical need since getField will return the data
+	uint16_t getFieldLength(uint8_t Index);
+	
+	// menthod to get the record length 
+	// maybe useful for computing data set size (records * recordlength)
+	uint16_t getRecordLength();
+	
+	// method to get the record length less the record check, the bytes saveRecord(Bytes, Length) takes
+	uint16_t getDataLength();
+
+	// method to return the used space
+	// simple (total records * recordlength)
+	uint32_t getUsedSpace();
+	
+	// method to return the chips card size as defined above in a #define
+	uint32_t getTotalSpace();	
+			
+	// overloaded functions to getField data
+	// the first call for a record reads the whole record into a buffer with one FASTREAD
+	// so reading every field of a record costs one chip transaction
+	// odd to pass variable in, but that is whats used
+	// to determine byte size to get and convert to a specific data type
+	// I'm happy to hear of a better way
+	uint8_t getField(uint8_t Data, uint8_t Field);
+#ifndef TEENSYDB_NO_INT_OVERLOAD
+	int getField(int Data, uint8_t Field);
+#endif
+	int16_t getField(int16_t Data, uint8_t Field);
+	uint16_t getField(uint16_t Data, uint8_t Field);
+	int32_t getField(int32_t Data, uint8_t Field);
+	uint32_t getField(uint32_t Data, uint8_t Field);
+	float getField(float Data, uint8_t Field);
+	double getField(double Data, uint8_t Field);
+	char *getCharField(uint8_t Field);
+
+	// method to stream a range of records to a callback, ideal for exporting
+	// many records are pulled from the chip per transaction and the callback is
+	// called once per record, inside the callback use getField as usual
+	// returns the number of records handed to the callback
+	// for example:
+	// bool PrintRecord(uint32_t Record) {
+	//   Serial.println(SSD.getField(MyVolts, MyVoltsID));
+	//   return true;
+	// }
+	// SSD.scan(1, SSD.getLastRecord(), PrintRecord);
+	// Prefetch reads the next block by DMA while the callback runs, only use it
+	// if the callback does not use the SPI bus (no SD card writes for example)
+	uint32_t scan(uint32_t StartRecord, uint32_t EndRecord, TeensyDBScanCallback Callback, bool Prefetch = false);
+	
+	// method to declare a field as the key, a value that never goes down from one record to the next
+	// (time stamp, sample number). must be a uint8_t, uint16_t or uint32_t field. with Index true a small
+	// index of keys is kept in RAM so seekKey reads fewer records
+	bool setKeyField(uint8_t Field, bool Index = false);
+	
+	// method to goto the first record with a key >= Value, returns the record or 0 if every key is smaller
+	// a binary search on the chip so even millions of records take ~20 small reads
+	uint32_t seekKey(uint32_t Value);
+	
+	// method to scan the records with keys from FromKey to ToKey, see scan
+	// SSD.scanKeys(StartTime, EndTime, PrintRecord);
+	uint32_t scanKeys(uint32_t FromKey, uint32_t ToKey, TeensyDBScanCallback Callback, bool Prefetch = false);
+	
+	// method to (re)build the key index now instead of on the first seekKey
+	void buildKeyIndex();
+	
+	// method to keep a min / max summary of each numeric field for every sector so scanWhere can skip
+	// sectors that can't match. records are packed into sectors, call after the fields are added and
+	// before findFirstWritableRecord, the same way every time. start with an erased chip
+	// returns false if a record plus the summary won't fit in a sector
+	bool setZoneMap(bool Enable);
+	
+	// method to scan only the records where Low <= Field <= High, see scan
+	// use -INFINITY or INFINITY for an open end, records where Temp > 100
+	// SSD.scanWhere(TempID, 100.001, INFINITY, PrintRecord);
+	uint32_t scanWhere(uint8_t Field, double Low, double High, TeensyDBScanCallback Callback, bool Prefetch = false);
+	
+	// method to store each record as the change from the one before it, slowly changing data takes a fraction of the space
+	// records can only be added at the end, reading a record costs a page read. can't be used with checkpoints,
+	// ring mode or zone maps (they are turned off). call after the fields are added and before findFirstWritableRecord,
+	// the same way every time. start with an erased chip. returns false if the record is too long to compress
+	bool setCompression(bool Enable);
+	
+	// method to get count, min, max, sum, mean and standard deviation of a numeric field over a range of records
+	// TeensyDBAggregate Volts = SSD.aggregate(VoltsID, 1, SSD.getLastRecord());
+	TeensyDBAggregate aggregate(uint8_t Field, uint32_t StartRecord, uint32_t EndRecord);
+	
+	// method to aggregate several fields in the same pass over the chip, Results holds one entry per field
+	// returns the number of records read
+	uint32_t aggregate(const uint8_t *Fields, uint8_t Count, TeensyDBAggregate *Results, uint32_t StartRecord, uint32_t EndRecord);
+
+	// method to dump bytes to the serial monitor. it will dump based on the set field list
+	// mainly for debugging, no known practical use
+	void dumpBytes();
+				
+private:
+
+	// record views decode straight from the field tables
+	friend class TeensyDBRecord;
+	
+#ifndef TEENSYDB_NO_STATS
+	TeensyDBStats Stats;
+	uint32_t PollStart = 0;
+#endif
+	
+	// method to wait on the chip, a timeout is counted and the wait goes in the Latency histogram
+	bool waitForChip(uint32_t Timeout, uint8_t Latency);
+	void addLatency(uint8_t Latency, uint32_t Start);
+	
+	// only important items will be explained
+#ifdef ARDUINO
+	TeensyDBSPIBus SPIBus;
+#endif
+	TeensyDBSPIFlash SPIFlash;
+	TeensyDBDevice *Device;
+	const TeensyDBChipProfile *Chip;
+	TeensyDBChipProfile Profile;
+	uint8_t ChipID[3];
+	unsigned long bt = 0;
+	bool RecordAdded = false;
+	bool ReadComplete = false;
+	char stng[TEENSYDB_MAXDATACHARLEN];
+	uint8_t RECORD[TEENSYDB_MAXREXORDLENGTH];
+	uint8_t RBUF[TEENSYDB_MAXREXORDLENGTH];
+	uint8_t *RecPtr = RBUF;
+	uint8_t SCANBUF[2][TEENSYDB_SCANBUFFER];
+	uint32_t CachedRecord = 0;
+	bool RecordCached = false;
+	bool initStatus = false;
+	uint32_t timeout = 0;
+	char ChipJEDEC[15];
+
+	bool NewCard = false;
+	uint8_t readvalue;
+	uint32_t TempAddress = 0;
+	volatile uint32_t Address = 0;
+	uint32_t MaxRecords = 0;
+	uint32_t LastRecord = 0;
+	uint32_t CurrentRecord = 0;
+	uint32_t i = 0, j = 0;
+	uint8_t q = 0;
+	uint8_t FieldCount = 0;
+	uint16_t status = 0;
+	uint16_t RecordLength;
+	int16_t pagesize;
+	size_t pageOffset;
+	
+	// the field list, one array per property indexed by field number, the variable behind each field is in FieldData
+	// (its type is DataType)
+	uint8_t DataType[MAX_FIELDS];
+	uint16_t FieldStart[MAX_FIELDS];
+	uint16_t FieldLength[MAX_FIELDS];
+	void *FieldData[MAX_FIELDS];
+	
+	// bit fields, where they start in the record (in bits) and how many bits, see addBitField
+	uint16_t FieldBit[MAX_FIELDS];
+	uint8_t FieldBits[MAX_FIELDS];
+	float FieldScale[MAX_FIELDS];
+	float FieldOffset[MAX_FIELDS];
+	uint16_t BitEnd = 0;
+	uint16_t BitLimit = 0;
+	
+	// record check, see setRecordCheck
+	uint8_t CheckLength = 0;
+	uint16_t CheckStart = 0;
+	bool RecordValid = true;
+	uint32_t BadRecords = 0;
+	
+	// schema, see setSchema
+	bool Schema = false;
+	bool SchemaBad = false;
+	bool ReadOnly = false;
+	uint32_t MetaStart = 0;
+	char FieldName[MAX_FIELDS][TEENSYDB_NAMELENGTH];
+	
+	// tables, see setTable
+	uint8_t Table = 0;
+	uint32_t Extents = 0;
+	uint32_t FreeSector = 0;
+	uint32_t ExtentStride = 1;
+	uint16_t ExtentIndex[TEENSYDB_EXTENTINDEX];
+	uint32_t ExtentCached = TEENSYDB_NOBLOCK;
+	uint32_t ExtentSector = 0;
+	
+	unsigned char wip_check;
+	uint32_t st = 0;
+	unsigned char ret = 0;
+	
+	// write queue, see setWriteCombine
+	uint8_t WQUEUE[TEENSYDB_WRITEQUEUE];
+	uint16_t WQHead = 0;
+	uint16_t WQCount = 0;
+	uint32_t WQAddress = 0;
+	bool WriteCombine = false;
+	uint16_t CombineRecords = 0;
+	uint32_t CombineTime = 0;
+	uint16_t PendingRecords = 0;
+	uint32_t PendingTime = 0;
+	uint16_t WQHighWater = 0;
+	volatile uint8_t WriteState = WS_IDLE;
+	
+	// checkpoints, see setCheckpoint
+	uint16_t CheckpointInterval = 0;
+	uint32_t CheckpointRecord = 0;
+	uint8_t CheckpointSector = 0;
+	uint32_t CheckpointSlot = 0;
+	uint32_t DataStart = 0;
+	
+	// ring mode, see setRingMode
+	bool RingMode = false;
+	uint32_t RecordsPerSector = 0;
+	uint32_t DataSectors = 0;
+	bool EraseAhead = false;
+	uint32_t EraseAddress = 0;
+	uint32_t QueuedRecord = 0;
+	
+	// erases in the background, see eraseAsync. EraseNext to EraseEnd is what's left of the range
+	// EraseStart and EraseLength the block the chip is on (ring mode's too), 0 when there's none
+	uint32_t EraseNext = 0;
+	uint32_t EraseEnd = 0;
+	uint32_t EraseStart = 0;
+	uint32_t EraseLength = 0;
+	uint32_t EraseTimeout = 0;
+	uint32_t EraseRun = 0;
+	bool EraseSuspended = false;
+	
+	// key field and index, see setKeyField
+	uint8_t KeyField = 0;
+	bool KeyIndex = false;
+	bool IndexBuilt = false;
+	uint32_t IndexStride = 1;
+	uint32_t IndexRecord[TEENSYDB_KEYINDEX];
+	uint32_t IndexKey[TEENSYDB_KEYINDEX];
+	
+	// zone maps, see setZoneMap. the summary of the sector being written is kept in RAM
+	bool ZoneMap = false;
+	bool ZoneLoaded = false;
+	uint16_t ZoneLength = 0;
+	uint16_t ZoneSlot[MAX_FIELDS];
+	uint32_t ZoneSector = 0;
+	double ZoneMin[MAX_FIELDS];
+	double ZoneMax[MAX_FIELDS];
+	
+	// compression, see setCompression. CompPrev is the last record saved, DecPrev the last one read
+	bool Compress = false;
+	uint32_t CompAddress = 0;
+	uint32_t CompRecord = 0;
+	uint8_t CompPrev[TEENSYDB_MAXREXORDLENGTH];
+	uint8_t CENTRY[TEENSYDB_MAXREXORDLENGTH + (2 * MAX_FIELDS) + 5];
+	uint8_t CBUF[PAGE_SIZE];
+	uint32_t DecBlock = TEENSYDB_NOBLOCK;
+	uint32_t DecRecord = 0;
+	uint16_t DecPos = 0;
+	uint8_t DecPrev[TEENSYDB_MAXREXORDLENGTH];
+	uint32_t BlockStride = 1;
+	uint32_t BlockIndex[TEENSYDB_BLOCKINDEX];
+	
+	// scanWhere filter, WhereField is 0 for a plain scan
+	uint8_t WhereField = 0;
+	double WhereLow = 0;
+	double WhereHigh = 0;
+	bool ScanStopped = false;
+	
+	// method to encode the field data into RECORD
+	void encodeRecord();
+	
+	// method to add the record check (if used) to RECORD
+	void sealRecord();
+	
+	// method to copy laid out bytes into RECORD and seal it, false if they don't fit these fields
+	bool copyRecord(const uint8_t *Bytes, uint16_t Length);
+	
+	// method to add RECORD to the write queue
+	void queueRecord();
+	
+	void writeRecord();
+	bool readChipJEDEC();
+	
+	// method to program the head of the write queue, never crosses a page
+	// if Wait is false the program is left running and WriteState is set
+	void programPage(bool Wait);
+	
+	// method to wait out a program started by programPage(false)
+	void finishProgram();
+	
+	// method to get the chip ready to read or program Length bytes at Address, suspending an erase if it can
+	// false if that means waiting and Wait is false
+	bool readyFor(uint32_t Address, uint32_t Length, bool Wait);
+	
+	// method to suspend the erase in progress once it has had its slice, false if the chip can't
+	bool suspendErase(bool Wait);
+	
+	// method to wait out an erase, a suspended one is resumed first
+	void finishErase();
+	
+	// method to resume a suspended erase or start the next one in the range, if the chip is free
+	void eraseStep();
+	
+	// contiguous copy of the page being programmed, DMA reads from here
+	uint8_t PBUF[PAGE_SIZE];
+	
+	// method to see if an address range is still in the write queue
+	bool isPending(uint32_t StartAddress, uint32_t Length);
+
+	// method to read data to the chip one byte at a time
+	// ReadData and SetAddress could be made public for getting data from the chip
+	// in an emergency situation
+	uint8_t readByte();
+	void setAddress(uint32_t Address);
+	
+	// method to read a block of bytes in one FASTREAD transaction
+	// if Wait is false the data is read in the background (DMA), Device->waitTransfer() before using it
+	void readBytes(uint32_t Address, uint8_t *Buffer, uint32_t Length, bool Wait = true);
+	
+	// method to pull the current record into RBUF, only reads the chip
+	// if the buffer is not already holding the current record
+	void loadRecord();
+	
+	// method to get the chip address of the start of a record
+	uint32_t recordAddress(uint32_t Record);
+	
+	// checkpoint methods, see setCheckpoint
+	void updateCheckpoint(bool Force);
+	void writeCheckpoint(uint32_t Record);
+	void readCheckpoint();
+	
+	// method to see if every byte is 0xFF
+	bool isErased(const uint8_t *Data, uint32_t Length);
+	
+	// method to see if a record has never been written (all 0xFF)
+	bool isRecordEmpty(uint32_t Record);
+	
+	// checkpoint spacing and how far past the checkpoint the end of the data can be
+	uint32_t checkpointInterval();
+	uint32_t checkpointWindow();
+	
+	// method to find the write head in ring mode when there is no usable checkpoint
+	uint32_t findRingEnd();
+	
+	// method to make sure the sector in front of the write head is erased, a power loss can cut its erase short
+	void checkRingAhead();
+	
+	// method to get how many records from Record can be read in one go (scan buffer, sector end in ring mode)
+	uint32_t chunkRecords(uint32_t Record, uint32_t EndRecord);
+	
+	// key field methods, see setKeyField
+	uint32_t readKey(uint32_t Record);
+	uint32_t decodeKey(const uint8_t *Bytes);
+	void addKeyIndex(uint32_t Record, uint32_t Key);
+	
+	// zone map methods, see setZoneMap
+	bool zoneMatch(uint32_t Record, uint8_t Field, double Low, double High);
+	void addZone(const uint8_t *Bytes);
+	void loadZone(uint32_t Record);
+	void queueZone();
+	
+	// compression methods, see setCompression
+	uint16_t packRecord(const uint8_t *Prev, uint8_t *Entry);
+	uint16_t unpackRecord(const uint8_t *Entry, uint8_t *Prev);
+	uint32_t blockFirst(uint32_t Block);
+	uint32_t findBlock(uint32_t Record);
+	bool openBlock(uint32_t Block);
+	bool readPacked(uint32_t Record, uint8_t *Buffer);
+	uint32_t findPackedEnd();
+	
+	// method to read Count records from Record into Buffer, compressed or not
+	void readRecords(uint32_t Record, uint8_t *Buffer, uint32_t Count, bool Wait = true);
+	
+	// record check methods, see setRecordCheck
+	uint32_t findEnd();
+	uint16_t crc16(const uint8_t *Bytes, uint16_t Length);
+	bool checkRecord(const uint8_t *Bytes);
+	
+	// schema methods, see setSchema
+	uint16_t buildSchema(uint8_t *Block);
+	uint16_t readSchema(uint8_t *Block);
+	bool checkSchema();
+	uint32_t schemaAddress();
+	bool schemaFits(uint16_t Fields);
+	
+	// table methods, see setTable
+	void loadExtents();
+	bool allocateExtent();
+	uint32_t recordExtent(uint32_t Record);
+	uint32_t extentSector(uint32_t Extent);
+	uint32_t findTableEnd();
+	
+	// bit and scaled field methods, see addBitField
+	uint8_t newField(uint8_t Type, void *Data, uint16_t Length);
+	uint16_t addBits(uint8_t Bits);
+	bool isBitField(uint8_t Field);
+	uint32_t getBits(const uint8_t *Bytes, uint8_t Field);
+	void putBits(uint8_t *Bytes, uint8_t Field, uint32_t Value);
+	uint32_t scaleValue(uint8_t Field, float Value);
+	
+	// method to decode a numeric field of an encoded record
+	double fieldValue(const uint8_t *Bytes, uint8_t Field);
+	
+	// method to find the first unwritten record in the Limit records from StartRecord
+	// returns 0 if it is not within Limit and MaxRecords + 1 if the chip is full
+	uint32_t findEmptyAfter(uint32_t StartRecord, uint32_t Limit);
+	
+	// method to save data on a field by field basis
+	// recall this library is a record/field database
+	//void saveField(uint8_t *Data, uint8_t Field);
+
+	// methods to convert data to by equivalent
+	void B2ToBytes(uint8_t *bytes, int16_t var);
+	void B2ToBytes(uint8_t *bytes, uint16_t var);
+#ifndef TEENSYDB_NO_INT_OVERLOAD
+	void B4ToBytes(uint8_t *bytes, int var);
+#endif
+	void B4ToBytes(uint8_t *bytes, int32_t var);
+	void B4ToBytes(uint8_t *bytes, uint32_t var);
+	void FloatToBytes(uint8_t *bytes, float var);
+	void DoubleToBytes(uint8_t *bytes, double var);
+	uint32_t BytesToB4(const uint8_t *bytes);
+	
+	// method to find max possible records
+	// done by taking chip size and dividing by record length
+	// and backing out 2 from possible partial record and the fact
+	// that we are starting at 1 (first record lenght is skipped)
+	void findMaxRecords();
+	
+	// menthod to get the field length so you can print it to some type of report
+	// not really a practical need since getField will return the data
+	uint16_t getFieldStart(uint8_t Index);
+		
+
+	
+};
+
+// record views, inline so a field is a few loads and shifts out of the buffer. the first argument of getField
+// only picks the overload
+
+inline bool TeensyDBRecord::isBitField(uint8_t Field) const {
+	return (DB->DataType[Field] >= DT_BITS8) && (DB->DataType[Field] <= DT_SCALED);
+}
+
+inline uint8_t TeensyDBRecord::getField(uint8_t, uint8_t Field) const {
+	if (isBitField(Field)) {
+		return (uint8_t) DB->getBits(Bytes, Field);
+	}
+	return Bytes[DB->FieldStart[Field]];
+}
+
+#ifndef TEENSYDB_NO_INT_OVERLOAD
+
+inline int TeensyDBRecord::getField(int Data, uint8_t Field) const {
+	return (int) getField((int32_t) Data, Field);
+}
+
+#endif
+
+inline int16_t TeensyDBRecord::getField(int16_t, uint8_t Field) const {
+	const uint8_t *b = &Bytes[DB->FieldStart[Field]];
+	if (isBitField(Field)) {
+		return (int16_t) DB->getBits(Bytes, Field);
+	}
+	return (int16_t) ((b[0] << 8) | b[1]);
+}
+
+inline uint16_t TeensyDBRecord::getField(uint16_t, uint8_t Field) const {
+	const uint8_t *b = &Bytes[DB->FieldStart[Field]];
+	if (isBitField(Field)) {
+		return (uint16_t) DB->getBits(Bytes, Field);
+	}
+	return (uint16_t) ((b[0] << 8) | b[1]);
+}
+
+inline int32_t TeensyDBRecord::getField(int32_t, uint8_t Field) const {
+	const uint8_t *b = &Bytes[DB->FieldStart[Field]];
+	if (isBitField(Field)) {
+		return (int32_t) DB->getBits(Bytes, Field);
+	}
+	return (int32_t) (((uint32_t) b[0] << 24) | ((uint32_t) b[1] << 16) | ((uint32_t) b[2] << 8) | b[3]);
+}
+
+inline uint32_t TeensyDBRecord::getField(uint32_t, uint8_t Field) const {
+	const uint8_t *b = &Bytes[DB->FieldStart[Field]];
+	if (isBitField(Field)) {
+		return DB->getBits(Bytes, Field);
+	}
+	return ((uint32_t) b[0] << 24) | ((uint32_t) b[1] << 16) | ((uint32_t) b[2] << 8) | b[3];
+}
+
+inline float TeensyDBRecord::getField(float, uint8_t Field) const {
+	float f;
+	if (isBitField(Field)) {
+		return (float) DB->fieldValue(Bytes, Field);
+	}
+	memcpy(&f, &Bytes[DB->FieldStart[Field]], sizeof(f));
+	return f;
+}
+
+inline double TeensyDBRecord::getField(double, uint8_t Field) const {
+	double d;
+	if (isBitField(Field)) {
+		return DB->fieldValue(Bytes, Field);
+	}
+	memcpy(&d, &Bytes[DB->FieldStart[Field]], sizeof(d));
+	return d;
+}
+
+inline const char *TeensyDBRecord::getCharField(uint8_t Field, uint16_t &Length) const {
+	const char *Text = (const char *) &Bytes[DB->FieldStart[Field]];
+	for (Length = 0; (Length < DB->FieldLength[Field]) && (Text[Length] != '\0'); Length++) {
+	}
+	return Text;
+}
+
+inline double TeensyDBRecord::getFieldValue(uint8_t Field) const {
+	return DB->fieldValue(Bytes, Field);
+}
+
+#endif
@@ -0,0 +1,330 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+#include "TeensyDBBus.h"
+
+bool TeensyDBBus::transferAsync(const uint8_t *TxBuffer, uint8_t *RxBuffer, uint32_t Length, TeensyDBBusCallback Callback, void *Context) {
+	
+	// no DMA, just do it now
+	transfer(TxBuffer, RxBuffer, Length);
+	deselect();
+	endTransaction();
+	
+	if (Callback != NULL) {
+		Callback(Context);
+	}
+	
+	return true;
+	
+}
+
+bool TeensyDBBus::isTransferDone() {
+	
+	return true;
+	
+}
+
+void TeensyDBBus::waitTransfer() {
+	
+	while (!isTransferDone()) {
+	}
+	
+}
+
+uint8_t TeensyDBBus::getMaxLanes() {
+	
+	return 1;
+	
+}
+
+void TeensyDBBus::receive(uint8_t *RxBuffer, uint32_t Length, uint8_t Lanes) {
+	
+	// single line bus, Lanes is always 1
+	(void) Lanes;
+	transfer(NULL, RxBuffer, Length);
+	
+}
+
+#ifdef ARDUINO
+
+TeensyDBSPIBus::TeensyDBSPIBus(uint8_t CS_PIN, SPIClass &SPIPort) {
+	
+	CSPin = CS_PIN;
+	Port = &SPIPort;
+	
+}
+
+void TeensyDBSPIBus::begin() {
+	
+	Port->begin();
+	
+	// im not a fan of delays, but some chips pin recovery is not as fast as expcted
+	delay(20);	
+	pinMode(CSPin, OUTPUT);
+
+	digitalWrite(CSPin, HIGH);
+	delay(20);
+	
+#ifdef SPI_HAS_TRANSFER_ASYNC
+	DMAEvent.setContext(this);
+	DMAEvent.attachImmediate(DMAComplete);
+#endif
+	
+}
+
+void TeensyDBSPIBus::beginTransaction(uint32_t Speed) {
+	
+	Port->beginTransaction(SPISettings(Speed, MSBFIRST, SPI_MODE0));
+	
+}
+
+void TeensyDBSPIBus::endTransaction() {
+	
+	Port->endTransaction();
+	
+}
+
+void TeensyDBSPIBus::select() {
+	
+	digitalWrite(CSPin, LOW);
+	
+}
+
+void TeensyDBSPIBus::deselect() {
+	
+	digitalWrite(CSPin, HIGH);
+	
+}
+
+uint8_t TeensyDBSPIBus::transfer(uint8_t Data) {
+	
+	return Port->transfer(Data);
+	
+}
+
+void TeensyDBSPIBus::transfer(const uint8_t *TxBuffer, uint8_t *RxBuffer, uint32_t Length) {
+	
+	Port->transfer(TxBuffer, RxBuffer, Length);
+	
+}
+
+bool TeensyDBSPIBus::transferAsync(const uint8_t *TxBuffer, uint8_t *RxBuffer, uint32_t Length, TeensyDBBusCallback Callback, void *Context) {
+	
+#ifdef SPI_HAS_TRANSFER_ASYNC
+
+	// short transfers are quicker done right here
+	if (Length >= TEENSYDB_DMA_MIN) {
+		
+		DoneCallback = Callback;
+		DoneContext = Context;
+		TransferDone = false;
+		
+		if (Port->transfer(TxBuffer, RxBuffer, Length, DMAEvent)) {
+			return true;
+		}
+		
+		// DMA could not be started, fall through and do it the slow way
+		TransferDone = true;
+	}
+	
+#endif
+
+	return TeensyDBBus::transferAsync(TxBuffer, RxBuffer, Length, Callback, Context);
+	
+}
+
+bool TeensyDBSPIBus::isTransferDone() {
+	
+	return TransferDone;
+	
+}
+
+#ifdef SPI_HAS_TRANSFER_ASYNC
+
+void TeensyDBSPIBus::DMAComplete(EventResponderRef Event) {
+	
+	// called from the DMA interrupt
+	TeensyDBSPIBus *Bus = (TeensyDBSPIBus *) Event.getContext();
+	
+	Bus->deselect();
+	Bus->endTransaction();
+	Bus->TransferDone = true;
+	
+	if (Bus->DoneCallback != NULL) {
+		Bus->DoneCallback(Bus->DoneContext);
+	}
+	
+}
+
+#endif
+
+// non Teensy boards don't have the fast pin functions
+#ifndef TEENSYDUINO
+	#define digitalWriteFast digitalWrite
+	#define digitalReadFast digitalRead
+#endif
+
+TeensyDBBitBangBus::TeensyDBBitBangBus(uint8_t CS_PIN, uint8_t SCK_PIN, uint8_t IO0_PIN, uint8_t IO1_PIN, uint8_t IO2_PIN, uint8_t IO3_PIN) {
+	
+	CSPin = CS_PIN;
+	SCKPin = SCK_PIN;
+	IOPin[0] = IO0_PIN;
+	IOPin[1] = IO1_PIN;
+	IOPin[2] = IO2_PIN;
+	IOPin[3] = IO3_PIN;
+	
+}
+
+void TeensyDBBitBangBus::begin() {
+	
+	pinMode(CSPin, OUTPUT);
+	digitalWrite(CSPin, HIGH);
+	
+	// mode 0, clock idles low
+	pinMode(SCKPin, OUTPUT);
+	digitalWrite(SCKPin, LOW);
+	
+	pinMode(IOPin[0], OUTPUT);
+	pinMode(IOPin[1], INPUT);
+	
+	// WP and HOLD high
+	if (IOPin[2] != 0xFF) {
+		pinMode(IOPin[2], OUTPUT);
+		digitalWrite(IOPin[2], HIGH);
+	}
+	if (IOPin[3] != 0xFF) {
+		pinMode(IOPin[3], OUTPUT);
+		digitalWrite(IOPin[3], HIGH);
+	}
+	
+	delay(20);
+	
+}
+
+void TeensyDBBitBangBus::beginTransaction(uint32_t Speed) {
+	
+	// no clock to set, it goes as fast as the pins toggle
+	(void) Speed;
+	
+}
+
+void TeensyDBBitBangBus::endTransaction() {
+	
+}
+
+void TeensyDBBitBangBus::select() {
+	
+	digitalWriteFast(CSPin, LOW);
+	
+}
+
+void TeensyDBBitBangBus::deselect() {
+	
+	digitalWriteFast(CSPin, HIGH);
+	
+}
+
+uint8_t TeensyDBBitBangBus::transfer(uint8_t Data) {
+	
+	uint8_t Bit = 0;
+	uint8_t Value = 0;
+	
+	// chip reads IO0 on the rising edge and changes IO1 on the falling edge
+	for (Bit = 0; Bit < 8; Bit++) {
+		digitalWriteFast(IOPin[0], (Data & 0x80) ? HIGH : LOW);
+		Data = Data << 1;
+		digitalWriteFast(SCKPin, HIGH);
+		Value = (Value << 1) | digitalReadFast(IOPin[1]);
+		digitalWriteFast(SCKPin, LOW);
+	}
+	
+	return Value;
+	
+}
+
+void TeensyDBBitBangBus::transfer(const uint8_t *TxBuffer, uint8_t *RxBuffer, uint32_t Length) {
+	
+	uint32_t i = 0;
+	uint8_t Value = 0;
+	
+	for (i = 0; i < Length; i++) {
+		Value = transfer(TxBuffer ? TxBuffer[i] : 0x00);
+		if (RxBuffer) {
+			RxBuffer[i] = Value;
+		}
+	}
+	
+}
+
+uint8_t TeensyDBBitBangBus::getMaxLanes() {
+	
+	if ((IOPin[2] != 0xFF) && (IOPin[3] != 0xFF)) {
+		return 4;
+	}
+	
+	return 2;
+	
+}
+
+void TeensyDBBitBangBus::receive(uint8_t *RxBuffer, uint32_t Length, uint8_t Lanes) {
+	
+	uint32_t i = 0;
+	uint8_t Bit = 0;
+	uint8_t Lane = 0;
+	uint8_t Value = 0;
+	
+	if (Lanes < 2) {
+		transfer(NULL, RxBuffer, Length);
+		return;
+	}
+	
+	// the chip drives all the data lines for the data phase
+	for (Lane = 0; Lane < Lanes; Lane++) {
+		pinMode(IOPin[Lane], INPUT);
+	}
+	
+	// IO(Lanes-1) has the high bit of each group
+	for (i = 0; i < Length; i++) {
+		Value = 0;
+		for (Bit = 0; Bit < 8; Bit = Bit + Lanes) {
+			digitalWriteFast(SCKPin, HIGH);
+			for (Lane = Lanes; Lane > 0; Lane--) {
+				Value = (Value << 1) | digitalReadFast(IOPin[Lane - 1]);
+			}
+			digitalWriteFast(SCKPin, LOW);
+		}
+		RxBuffer[i] = Value;
+	}
+	
+	// back to normal SPI, WP and HOLD high
+	pinMode(IOPin[0], OUTPUT);
+	for (Lane = 2; Lane < Lanes; Lane++) {
+		pinMode(IOPin[Lane], OUTPUT);
+		digitalWriteFast(IOPin[Lane], HIGH);
+	}
+	
+}
+
+#endif
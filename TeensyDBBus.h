@@ -0,0 +1,162 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+/*
+
+the bus is the only place the library touches the SPI peripheral and the chip select pin.
+TeensyDB talks to the flash chip through a TeensyDBBus so the transport can be swapped, either for
+DMA driven transfers on a Teensy, or for a mock on a PC so the library can be tested without hardware
+
+*/
+
+#ifndef TEENSYDB_BUS_H
+#define TEENSYDB_BUS_H
+
+#if ARDUINO >= 100
+	 #include "Arduino.h"
+#else
+	 #include "TeensyDBHost.h"
+#endif
+
+#ifdef ARDUINO
+	 #include <SPI.h>
+#endif
+
+// transfers shorter than this are not worth the DMA setup time
+#define TEENSYDB_DMA_MIN 32
+
+// called when an async transfer completes, may be called from an interrupt
+typedef void (*TeensyDBBusCallback)(void *Context);
+
+class TeensyDBBus {
+	
+public:
+
+	// set up the pins and peripheral
+	virtual void begin() = 0;
+	
+	// bracket a group of transfers at a given clock speed
+	virtual void beginTransaction(uint32_t Speed) = 0;
+	virtual void endTransaction() = 0;
+	
+	// drive the chip select low (select) and high (deselect)
+	virtual void select() = 0;
+	virtual void deselect() = 0;
+	
+	// single byte transfer
+	virtual uint8_t transfer(uint8_t Data) = 0;
+	
+	// block transfer, TxBuffer may be NULL to clock out zeros and RxBuffer may be NULL to discard
+	virtual void transfer(const uint8_t *TxBuffer, uint8_t *RxBuffer, uint32_t Length) = 0;
+	
+	// method to start a block transfer and return right away. when the transfer completes the bus
+	// deselects the chip, ends the transaction and calls Callback. buffers must stay valid until then
+	// the default is a blocking transfer, so a bus without DMA still works
+	virtual bool transferAsync(const uint8_t *TxBuffer, uint8_t *RxBuffer, uint32_t Length, TeensyDBBusCallback Callback, void *Context);
+	
+	// method to see if the last async transfer is finished
+	virtual bool isTransferDone();
+	
+	// method to wait for the last async transfer to finish
+	void waitTransfer();
+	
+	// number of data lines the bus can read on at once, 1 for a normal SPI bus
+	virtual uint8_t getMaxLanes();
+	
+	// method to clock in a block on 1, 2 or 4 data lines (dual / quad output read data phase)
+	// the command, address and dummy bytes must already have gone out with transfer()
+	virtual void receive(uint8_t *RxBuffer, uint32_t Length, uint8_t Lanes);
+	
+	virtual ~TeensyDBBus() {}
+	
+};
+
+#ifdef ARDUINO
+
+// the SPI bus, on Teensy 3.x / 4.x block transfers are handed to DMA
+class TeensyDBSPIBus : public TeensyDBBus {
+	
+public:
+
+	TeensyDBSPIBus(uint8_t CS_PIN, SPIClass &SPIPort = SPI);
+	
+	void begin();
+	void beginTransaction(uint32_t Speed);
+	void endTransaction();
+	void select();
+	void deselect();
+	uint8_t transfer(uint8_t Data);
+	void transfer(const uint8_t *TxBuffer, uint8_t *RxBuffer, uint32_t Length);
+	bool transferAsync(const uint8_t *TxBuffer, uint8_t *RxBuffer, uint32_t Length, TeensyDBBusCallback Callback, void *Context);
+	bool isTransferDone();
+	
+private:
+
+	uint8_t CSPin;
+	SPIClass *Port;
+	volatile bool TransferDone = true;
+	TeensyDBBusCallback DoneCallback = NULL;
+	void *DoneContext = NULL;
+	
+#ifdef SPI_HAS_TRANSFER_ASYNC
+	EventResponder DMAEvent;
+	static void DMAComplete(EventResponderRef Event);
+#endif
+
+};
+
+// bit banged SPI on any 4 or 6 pins, slower per line than the SPI port but it can read 2 bits (IO0, IO1) or
+// 4 bits (IO0-IO3) per clock for dual and quad output reads. IO2 and IO3 are the chip's WP and HOLD pins and are
+// held high when not reading. runs as fast as the MCU can toggle pins, the speed in beginTransaction is ignored
+// the pins are set at run time so digitalWriteFast is no faster than digitalWrite, expect a few MHz (not measured,
+// the host sim guesses 5). at that a dual read is slower than a single line read on the SPI port and a quad read
+// is still no faster, this bus is for boards where the SPI port is taken, not for speed
+class TeensyDBBitBangBus : public TeensyDBBus {
+	
+public:
+
+	TeensyDBBitBangBus(uint8_t CS_PIN, uint8_t SCK_PIN, uint8_t IO0_PIN, uint8_t IO1_PIN, uint8_t IO2_PIN = 0xFF, uint8_t IO3_PIN = 0xFF);
+	
+	void begin();
+	void beginTransaction(uint32_t Speed);
+	void endTransaction();
+	void select();
+	void deselect();
+	uint8_t transfer(uint8_t Data);
+	void transfer(const uint8_t *TxBuffer, uint8_t *RxBuffer, uint32_t Length);
+	uint8_t getMaxLanes();
+	void receive(uint8_t *RxBuffer, uint32_t Length, uint8_t Lanes);
+	
+private:
+
+	uint8_t CSPin;
+	uint8_t SCKPin;
+	uint8_t IOPin[4];
+	
+};
+
+#endif
+
+#endif
@@ -0,0 +1,132 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+#include "TeensyDB.h"
+#include "TeensyDBChip.h"
+
+/*
+
+known chips, times are data sheet max in ms (the suspend time in us). the dual and quad read codes are output only
+(command and address on one line), the way TeensyDB can drive them.
+
+chips over 16 MB use 4 byte addresses with the 4 byte instruction codes (0x13 read, 0x0C fast read, 0x12 program,
+0x21 sector erase, 0xDC 64k erase). there is no 4 byte 32k erase so those are done a sector at a time
+
+*/
+
+static const TeensyDBChipProfile ChipTable[] = {
+	
+	// name          JEDEC ID            capacity  page  sector  32k    64k    addr clock      prog  sector  32k   64k   chip     read  fast  dummy dual  quad  prog  sector 32k   64k   chip  unique suspend resume us
+	{ "SST25PF040C", { 0x62, 0x06, 0x13 }, 524288,  256,  4096, 32768, 65536, 3,  40000000,  5,   100,    100,  100,  500,     0x03, 0x0B, 1,    0x3B, 0x00, 0x02, 0x20,  0x52, 0xD8, 0x60, 0x00, 0x00, 0x00, 0 },
+	{ "W25Q16JV",    { 0xEF, 0x40, 0x15 }, 2097152, 256,  4096, 32768, 65536, 3, 133000000,  3,   400,   1600, 2000,  25000,   0x03, 0x0B, 1,    0x3B, 0x6B, 0x02, 0x20,  0x52, 0xD8, 0x60, 0x4B, 0x75, 0x7A, 20 },
+	{ "W25Q32JV",    { 0xEF, 0x40, 0x16 }, 4194304, 256,  4096, 32768, 65536, 3, 133000000,  3,   400,   1600, 2000,  50000,   0x03, 0x0B, 1,    0x3B, 0x6B, 0x02, 0x20,  0x52, 0xD8, 0x60, 0x4B, 0x75, 0x7A, 20 },
+	{ "W25Q64JV",    { 0xEF, 0x40, 0x17 }, 8388608, 256,  4096, 32768, 65536, 3, 133000000,  3,   400,   1600, 2000, 100000,   0x03, 0x0B, 1,    0x3B, 0x6B, 0x02, 0x20,  0x52, 0xD8, 0x60, 0x4B, 0x75, 0x7A, 20 },
+	{ "W25Q128JV",   { 0xEF, 0x40, 0x18 }, 16777216,256,  4096, 32768, 65536, 3, 133000000,  3,   400,   1600, 2000, 200000,   0x03, 0x0B, 1,    0x3B, 0x6B, 0x02, 0x20,  0x52, 0xD8, 0x60, 0x4B, 0x75, 0x7A, 20 },
+	{ "W25Q256JV",   { 0xEF, 0x40, 0x19 }, 33554432,256,  4096, 32768, 65536, 4, 133000000,  3,   400,   1600, 2000, 400000,   0x13, 0x0C, 1,    0x3C, 0x6C, 0x12, 0x21,  0x00, 0xDC, 0x60, 0x4B, 0x75, 0x7A, 20 },
+	{ "W25Q512JV",   { 0xEF, 0x40, 0x20 }, 67108864,256,  4096, 32768, 65536, 4, 133000000,  3,   400,   1600, 2000, 800000,   0x13, 0x0C, 1,    0x3C, 0x6C, 0x12, 0x21,  0x00, 0xDC, 0x60, 0x4B, 0x75, 0x7A, 20 }
+	
+};
+
+#define CHIP_COUNT (sizeof(ChipTable) / sizeof(ChipTable[0]))
+
+void TeensyDBDefaultChip(TeensyDBChipProfile *Profile) {
+	
+	Profile->Name = "GENERIC";
+	Profile->ID[0] = 0;
+	Profile->ID[1] = 0;
+	Profile->ID[2] = 0;
+	
+	Profile->Capacity = CARD_SIZE;
+	Profile->PageSize = PAGE_SIZE;
+	Profile->SectorSize = SECTOR_SIZE;
+	Profile->SmallBlockSize = SMALL_BLOCK_SIZE;
+	Profile->LargeBlockSize = LARGE_BLOCK_SIZE;
+	Profile->AddressBytes = 3;
+	
+	Profile->MaxClock = SPEED_READ;
+	
+	// the timeouts this library always used
+	Profile->ProgramTime = 50;
+	Profile->SectorEraseTime = 60000;
+	Profile->SmallBlockEraseTime = 60000;
+	Profile->LargeBlockEraseTime = 60000;
+	Profile->ChipEraseTime = 600000;
+	
+	Profile->ReadCmd = READ;
+	Profile->FastReadCmd = FASTREAD;
+	Profile->FastReadDummy = 1;
+	Profile->DualReadCmd = 0x00;
+	Profile->QuadReadCmd = 0x00;
+	Profile->ProgramCmd = WRITE;
+	Profile->SectorEraseCmd = SECTORERASE;
+	Profile->SmallBlockEraseCmd = SMALLBLOCKERASE;
+	Profile->LargeBlockEraseCmd = LARGEBLOCKERASE;
+	Profile->ChipEraseCmd = CHIPERASE;
+	Profile->UniqueIDCmd = UNIQUEID;
+	
+	// not every chip can suspend an erase, so an unknown one is assumed not to
+	Profile->SuspendCmd = 0x00;
+	Profile->ResumeCmd = 0x00;
+	Profile->SuspendTime = 0;
+	
+}
+
+bool TeensyDBFindChip(const uint8_t *ID, TeensyDBChipProfile *Profile) {
+	
+	uint8_t i = 0;
+	
+	for (i = 0; i < CHIP_COUNT; i++) {
+		if ((ChipTable[i].ID[0] == ID[0]) && (ChipTable[i].ID[1] == ID[1]) && (ChipTable[i].ID[2] == ID[2])) {
+			*Profile = ChipTable[i];
+			return true;
+		}
+	}
+	
+	// not one we know, most SPI NOR chips report the size as a power of 2 in the capacity byte
+	// so use that with the default (standard) instruction set
+	TeensyDBDefaultChip(Profile);
+	
+	Profile->ID[0] = ID[0];
+	Profile->ID[1] = ID[1];
+	Profile->ID[2] = ID[2];
+	
+	if ((ID[2] >= 0x10) && (ID[2] <= 0x1F)) {
+		Profile->Capacity = (uint32_t) 1 << ID[2];
+	}
+	
+	// over 16 MB, switch to the standard 4 byte instruction codes
+	if (Profile->Capacity > 16777216) {
+		Profile->AddressBytes = 4;
+		Profile->ReadCmd = 0x13;
+		Profile->FastReadCmd = 0x0C;
+		Profile->ProgramCmd = 0x12;
+		Profile->SectorEraseCmd = 0x21;
+		Profile->SmallBlockEraseCmd = 0x00;
+		Profile->LargeBlockEraseCmd = 0xDC;
+	}
+	
+	return false;
+	
+}
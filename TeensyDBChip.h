@@ -0,0 +1,95 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+/*
+
+chip profiles, everything TeensyDB needs to know about a flash chip: size, page / sector / block sizes,
+max clock, worst case program and erase times and instruction codes. init() reads the JEDEC ID and picks
+the matching profile from the table in TeensyDBChip.cpp, so one sketch can run on different chips.
+
+to add a chip, add a line to the table (values from the data sheet, times are the max, not typical)
+or build a profile in the sketch and pass it to TeensyDB::setChipProfile() after init()
+
+*/
+
+#ifndef TEENSYDB_CHIP_H
+#define TEENSYDB_CHIP_H
+
+#include <stdint.h>
+
+struct TeensyDBChipProfile {
+	
+	const char *Name;
+	uint8_t ID[3];				// manufacturer, type, capacity
+	
+	// geometry, bytes
+	uint32_t Capacity;
+	uint16_t PageSize;
+	uint32_t SectorSize;
+	uint32_t SmallBlockSize;
+	uint32_t LargeBlockSize;
+	
+	// address bytes sent with each command, 3 or 4 (chips over 16 MB)
+	// 4 byte chips use the 4 byte instruction codes below so the chip never needs a mode switch
+	uint8_t AddressBytes;
+	
+	// max SPI clock for FASTREAD, Hz
+	uint32_t MaxClock;
+	
+	// worst case times, ms
+	uint32_t ProgramTime;
+	uint32_t SectorEraseTime;
+	uint32_t SmallBlockEraseTime;
+	uint32_t LargeBlockEraseTime;
+	uint32_t ChipEraseTime;
+	
+	// instruction codes, 0 if the chip does not have it
+	uint8_t ReadCmd;
+	uint8_t FastReadCmd;
+	uint8_t FastReadDummy;			// dummy bytes after the address
+	uint8_t DualReadCmd;			// dual output fast read
+	uint8_t QuadReadCmd;			// quad output fast read
+	uint8_t ProgramCmd;
+	uint8_t SectorEraseCmd;
+	uint8_t SmallBlockEraseCmd;		// 0 if the chip has none, the block is erased a sector at a time
+	uint8_t LargeBlockEraseCmd;
+	uint8_t ChipEraseCmd;
+	uint8_t UniqueIDCmd;
+	
+	// erase suspend and resume, 0 if the chip has none, and the most the chip takes to suspend, us
+	uint8_t SuspendCmd;
+	uint8_t ResumeCmd;
+	uint16_t SuspendTime;
+	
+};
+
+// function to get the profile for a JEDEC ID, returns false if the chip is not in the table
+// in which case Profile is filled with the defaults from TeensyDB.h and the capacity from the ID
+bool TeensyDBFindChip(const uint8_t *ID, TeensyDBChipProfile *Profile);
+
+// function to get the default profile (the compile time settings in TeensyDB.h)
+void TeensyDBDefaultChip(TeensyDBChipProfile *Profile);
+
+#endif
@@ -0,0 +1,415 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+#include "TeensyDB.h"
+#include "TeensyDBDevice.h"
+
+TeensyDBDevice::TeensyDBDevice() {
+	
+	TeensyDBDefaultChip(&Chip);
+	
+}
+
+bool TeensyDBDevice::suspend() {
+	
+	return false;
+	
+}
+
+void TeensyDBDevice::resume() {
+	
+}
+
+bool TeensyDBDevice::isTransferDone() {
+	
+	return true;
+	
+}
+
+void TeensyDBDevice::waitTransfer() {
+	
+	while (!isTransferDone()) {
+	}
+	
+}
+
+bool TeensyDBDevice::isReady() {
+	
+	if (!isTransferDone()) {
+		return false;
+	}
+	
+	TEENSYDB_STAT(StatusPolls++);
+	
+	return !(readStatus() & STAT_WIP);
+	
+}
+
+bool TeensyDBDevice::waitReady(uint32_t Timeout) {
+	
+	uint32_t Start = millis();
+	
+	waitTransfer();
+	
+	TEENSYDB_STAT(StatusPolls++);
+	
+	while (readStatus() & STAT_WIP){
+		TEENSYDB_STAT(StatusPolls++);
+		if ((millis() - Start) > Timeout) {
+			return false; // timeout
+		}
+	}
+	
+	return true;
+	
+}
+
+uint32_t TeensyDBDevice::getStatusPolls() {
+	
+	return StatusPolls;
+	
+}
+
+void TeensyDBDevice::setProfile(const TeensyDBChipProfile &Profile) {
+	
+	Chip = Profile;
+	
+}
+
+const TeensyDBChipProfile &TeensyDBDevice::getProfile() {
+	
+	return Chip;
+	
+}
+
+uint8_t TeensyDBDevice::setReadLanes(uint8_t Lanes) {
+	
+	// single line unless the device says otherwise
+	(void) Lanes;
+	ReadLanes = 1;
+	
+	return ReadLanes;
+	
+}
+
+uint8_t TeensyDBDevice::getReadLanes() {
+	
+	return ReadLanes;
+	
+}
+
+TeensyDBSPIFlash::TeensyDBSPIFlash(TeensyDBBus *FlashBus) {
+	
+	Bus = FlashBus;
+	
+	setProfile(Chip);
+	
+}
+
+void TeensyDBSPIFlash::setProfile(const TeensyDBChipProfile &Profile) {
+	
+	Chip = Profile;
+	
+	// a new chip starts out single line, setReadLanes again if needed
+	ReadLanes = 1;
+	
+	// SPEED_READ and SPEED_WRITE are what the board can do, never go faster than the chip
+	ReadSpeed = (Chip.MaxClock < SPEED_READ) ? Chip.MaxClock : SPEED_READ;
+	WriteSpeed = (Chip.MaxClock < SPEED_WRITE) ? Chip.MaxClock : SPEED_WRITE;
+	
+}
+
+bool TeensyDBSPIFlash::begin() {
+	
+	Bus->begin();
+	
+	return true;
+	
+}
+
+void TeensyDBSPIFlash::readJEDEC(uint8_t *ID) {
+	
+	Bus->beginTransaction(WriteSpeed);
+	Bus->select();
+	delay(10);
+	
+	Bus->transfer(JEDEC);
+	Bus->transfer(NULL, ID, 3);
+	
+	Bus->deselect();
+	Bus->endTransaction();
+	
+}
+
+void TeensyDBSPIFlash::readUniqueID(uint8_t *ID) {
+	
+	if (Chip.UniqueIDCmd == 0x00) {
+		// chip does not have one
+		memset(ID, 0xFF, 8);
+		return;
+	}
+	
+	Bus->beginTransaction(WriteSpeed);
+	Bus->select();
+	delay(10);
+	
+	Bus->transfer(Chip.UniqueIDCmd);
+
+	// 4 dummy bytes
+	Bus->transfer(NULL, NULL, 4);
+	Bus->transfer(NULL, ID, 8);
+	
+	Bus->deselect();
+	Bus->endTransaction();
+	
+}
+
+void TeensyDBSPIFlash::read(uint32_t Address, uint8_t *Buffer, uint32_t Length, bool Wait) {
+	
+	// one FASTREAD transaction for the whole block, the chip auto increments the address
+	// so we only pay the command, address and dummy byte once
+	if (ReadLanes == 4) {
+		CmdLength = buildCommandBytes(CmdBytes, Chip.QuadReadCmd, Address);
+	}
+	else if (ReadLanes == 2) {
+		CmdLength = buildCommandBytes(CmdBytes, Chip.DualReadCmd, Address);
+	}
+	else {
+		CmdLength = buildCommandBytes(CmdBytes, Chip.FastReadCmd, Address);
+	}
+	
+	memset(&CmdBytes[CmdLength], 0x00, Chip.FastReadDummy);
+	CmdLength = CmdLength + Chip.FastReadDummy;
+	
+	Bus->beginTransaction(ReadSpeed);
+	
+	Bus->select();
+	Bus->transfer(CmdBytes, NULL, CmdLength);
+	
+	// dual and quad reads are clocked in by the CPU, so they always wait
+	if ((!Wait) && (ReadLanes == 1)){
+		// the bus deselects and ends the transaction when the data is in
+		Bus->transferAsync(NULL, Buffer, Length, NULL, NULL);
+		return;
+	}
+	
+	Bus->receive(Buffer, Length, ReadLanes);
+	Bus->deselect();
+	
+	Bus->endTransaction();
+	
+}
+
+void TeensyDBSPIFlash::program(uint32_t Address, const uint8_t *Buffer, uint32_t Length) {
+	
+	writeEnable();
+	
+	CmdLength = buildCommandBytes(CmdBytes, Chip.ProgramCmd, Address);
+	
+	Bus->beginTransaction(WriteSpeed);
+	Bus->select();
+	Bus->transfer(CmdBytes, NULL, CmdLength);
+	
+	// the data goes out by DMA if the bus supports it, the bus deselects the chip
+	// when it's done which starts the program
+	Bus->transferAsync(Buffer, NULL, Length, NULL, NULL);
+	
+}
+
+void TeensyDBSPIFlash::erase(uint8_t Type, uint32_t Address) {
+	
+	writeEnable();
+	
+	Bus->beginTransaction(WriteSpeed);
+	Bus->select();
+	
+	if (Type == ERASE_CHIP) {
+		Bus->transfer(Chip.ChipEraseCmd);
+	}
+	else {
+		if (Type == ERASE_SMALLBLOCK) {
+			CmdLength = buildCommandBytes(CmdBytes, Chip.SmallBlockEraseCmd, Address);
+		}
+		else if (Type == ERASE_LARGEBLOCK) {
+			CmdLength = buildCommandBytes(CmdBytes, Chip.LargeBlockEraseCmd, Address);
+		}
+		else {
+			CmdLength = buildCommandBytes(CmdBytes, Chip.SectorEraseCmd, Address);
+		}
+		Bus->transfer(CmdBytes, NULL, CmdLength);
+	}
+	
+	Bus->deselect();
+	Bus->endTransaction();
+	
+}
+
+uint8_t TeensyDBSPIFlash::readStatus() {
+	
+	uint8_t Status = 0;
+	
+	Bus->beginTransaction(WriteSpeed);
+	Bus->select();
+	Bus->transfer(CMD_READ_STATUS_REG);
+	Status = Bus->transfer(0x00);
+	Bus->deselect();
+	Bus->endTransaction();
+	
+	return Status;
+	
+}
+
+bool TeensyDBSPIFlash::suspend() {
+	
+	if (Chip.SuspendCmd == 0x00) {
+		return false;
+	}
+	
+	// no write enable, the chip takes these while it's busy
+	Bus->beginTransaction(WriteSpeed);
+	Bus->select();
+	Bus->transfer(Chip.SuspendCmd);
+	Bus->deselect();
+	Bus->endTransaction();
+	
+	return true;
+	
+}
+
+void TeensyDBSPIFlash::resume() {
+	
+	if (Chip.ResumeCmd == 0x00) {
+		return;
+	}
+	
+	Bus->beginTransaction(WriteSpeed);
+	Bus->select();
+	Bus->transfer(Chip.ResumeCmd);
+	Bus->deselect();
+	Bus->endTransaction();
+	
+}
+
+bool TeensyDBSPIFlash::isTransferDone() {
+	
+	return Bus->isTransferDone();
+	
+}
+
+uint8_t TeensyDBSPIFlash::setReadLanes(uint8_t Lanes) {
+	
+	// 1, 2 or 4, rounded down to what the bus and chip can do
+	if (Lanes > 4) {
+		Lanes = 4;
+	}
+	if (Lanes == 3) {
+		Lanes = 2;
+	}
+	if (Lanes > Bus->getMaxLanes()) {
+		Lanes = Bus->getMaxLanes();
+	}
+	if ((Lanes == 4) && (Chip.QuadReadCmd == 0x00)) {
+		Lanes = 2;
+	}
+	if ((Lanes == 2) && (Chip.DualReadCmd == 0x00)) {
+		Lanes = 1;
+	}
+	if (Lanes == 0) {
+		Lanes = 1;
+	}
+	
+	if (Lanes == 4) {
+		enableQuad();
+	}
+	
+	ReadLanes = Lanes;
+	
+	return ReadLanes;
+	
+}
+
+void TeensyDBSPIFlash::enableQuad() {
+	
+	uint8_t Status2 = 0;
+	
+	// Winbond style, QE is bit 1 of status register 2 (read 0x35, write 0x31)
+	// the bit is non volatile so this only writes the chip the first time, and it stays set for good
+	Bus->beginTransaction(WriteSpeed);
+	Bus->select();
+	Bus->transfer(0x35);
+	Status2 = Bus->transfer(0x00);
+	Bus->deselect();
+	Bus->endTransaction();
+	
+	if (Status2 & 0x02) {
+		return;
+	}
+	
+	writeEnable();
+	
+	Bus->beginTransaction(WriteSpeed);
+	Bus->select();
+	Bus->transfer(0x31);
+	Bus->transfer(Status2 | 0x02);
+	Bus->deselect();
+	Bus->endTransaction();
+	
+	// status register writes take up to 15 ms
+	waitReady(20);
+	
+}
+
+void TeensyDBSPIFlash::writeEnable() {
+	
+	// chip ignores a write enable while it's busy
+	waitReady(Chip.ProgramTime);
+	
+	Bus->beginTransaction(WriteSpeed);
+	Bus->select();
+	Bus->transfer(WRITEENABLE);
+	Bus->deselect(); 
+	Bus->endTransaction();
+	
+}
+
+uint8_t TeensyDBSPIFlash::buildCommandBytes(uint8_t *buf, uint8_t cmd, uint32_t addr) {
+	
+	buf[0] = cmd;
+	
+	if (Chip.AddressBytes == 4) {
+		buf[1] = addr >> 24;
+		buf[2] = addr >> 16;
+		buf[3] = addr >> 8;
+		buf[4] = addr;
+		return 5;
+	}
+	
+	buf[1] = addr >> 16;
+	buf[2] = addr >> 8;
+	buf[3] = addr;
+	
+	return 4;
+
+}
@@ -0,0 +1,164 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+/*
+
+a TeensyDBDevice is the flash chip as TeensyDB sees it: read, program, erase, status and ID.
+TeensyDBSPIFlash is the real chip on a TeensyDBBus, anything else (a simulated chip on a PC for example)
+just needs to implement the same handful of methods
+
+*/
+
+#ifndef TEENSYDB_DEVICE_H
+#define TEENSYDB_DEVICE_H
+
+#if ARDUINO >= 100
+	 #include "Arduino.h"
+#else
+	 #include "TeensyDBHost.h"
+#endif
+
+#include "TeensyDBBus.h"
+#include "TeensyDBChip.h"
+
+// erase types
+#define ERASE_SECTOR 0
+#define ERASE_SMALLBLOCK 1
+#define ERASE_LARGEBLOCK 2
+#define ERASE_CHIP 3
+
+class TeensyDBDevice {
+	
+public:
+
+	TeensyDBDevice();
+
+	// set up the device, called from TeensyDB::init()
+	virtual bool begin() = 0;
+	
+	// method to get the 3 JEDEC bytes (manufacturer, type, capacity)
+	virtual void readJEDEC(uint8_t *ID) = 0;
+	
+	// method to get the 8 byte unique ID
+	virtual void readUniqueID(uint8_t *ID) = 0;
+	
+	// method to read a block, with Wait false the read is started in the background
+	// and the data is valid once isTransferDone() is true
+	virtual void read(uint32_t Address, uint8_t *Buffer, uint32_t Length, bool Wait = true) = 0;
+	
+	// method to start a page program, must not cross a page boundary
+	// returns once the data is on its way, Buffer must stay valid until isReady()
+	virtual void program(uint32_t Address, const uint8_t *Buffer, uint32_t Length) = 0;
+	
+	// method to start an erase (ERASE_SECTOR, ERASE_SMALLBLOCK, ERASE_LARGEBLOCK, ERASE_CHIP)
+	virtual void erase(uint8_t Type, uint32_t Address) = 0;
+	
+	// method to read the status register
+	virtual uint8_t readStatus() = 0;
+	
+	// method to suspend a sector or block erase so the chip takes reads and programs outside the block,
+	// false if the chip can't. the chip is ready again after the profile SuspendTime
+	virtual bool suspend();
+	
+	// method to carry on with a suspended erase
+	virtual void resume();
+	
+	// method to see if a background transfer is still running
+	virtual bool isTransferDone();
+	
+	// method to wait for a background transfer
+	void waitTransfer();
+	
+	// method to see if the chip is done with the last program or erase
+	bool isReady();
+	
+	// method to wait for the chip, Timeout in ms, returns false if we timed out
+	bool waitReady(uint32_t Timeout);
+	
+	// method to get how many times isReady and waitReady have read the status register
+	uint32_t getStatusPolls();
+	
+	// method to set the chip profile (geometry, timing, instruction codes), TeensyDB::init() sets it from the JEDEC ID
+	virtual void setProfile(const TeensyDBChipProfile &Profile);
+	
+	// method to get the chip profile in use
+	const TeensyDBChipProfile &getProfile();
+	
+	// method to read on 1, 2 (dual output) or 4 (quad output) data lines, limited by what the chip
+	// and bus can do. returns the number of lines that will be used
+	virtual uint8_t setReadLanes(uint8_t Lanes);
+	uint8_t getReadLanes();
+	
+	virtual ~TeensyDBDevice() {}
+	
+protected:
+
+	TeensyDBChipProfile Chip;
+	uint8_t ReadLanes = 1;
+	uint32_t StatusPolls = 0;
+	
+};
+
+// a SPI NOR flash chip on a TeensyDBBus
+class TeensyDBSPIFlash : public TeensyDBDevice {
+	
+public:
+
+	TeensyDBSPIFlash(TeensyDBBus *FlashBus);
+	
+	bool begin();
+	void readJEDEC(uint8_t *ID);
+	void readUniqueID(uint8_t *ID);
+	void read(uint32_t Address, uint8_t *Buffer, uint32_t Length, bool Wait = true);
+	void program(uint32_t Address, const uint8_t *Buffer, uint32_t Length);
+	void erase(uint8_t Type, uint32_t Address);
+	uint8_t readStatus();
+	bool suspend();
+	void resume();
+	bool isTransferDone();
+	void setProfile(const TeensyDBChipProfile &Profile);
+	uint8_t setReadLanes(uint8_t Lanes);
+	
+private:
+
+	TeensyDBBus *Bus;
+	uint8_t CmdBytes[8];
+	uint8_t CmdLength = 0;
+	uint32_t ReadSpeed;
+	uint32_t WriteSpeed;
+	
+	// method to send a write enable
+	void writeEnable();
+	
+	// method to set the quad enable bit, without it IO2 and IO3 are WP and HOLD. the bit is non volatile, the
+	// chip keeps it (and WP / HOLD stay off) after a power cycle until status register 2 is written again
+	void enableQuad();
+	
+	// function to build byte list of command + 24 or 32 bit address, returns the number of bytes
+	uint8_t buildCommandBytes(uint8_t *buf, uint8_t cmd, uint32_t addr);
+	
+};
+
+#endif
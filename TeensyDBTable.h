@@ -0,0 +1,267 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+/*
+
+typed records, the fields of a struct are listed once and the compiler works out where each one goes in the
+record. save() and read() are then a straight run of byte copies with the offsets built in, no per field type
+checks and no dummy value to pick a getField overload
+
+	struct Reading {
+		uint32_t Point;
+		float Volts;
+		int16_t Temp;
+		char Name[12];
+	};
+
+	TeensyDBTable<Reading,
+		TEENSYDB_FIELD(Reading, Point),
+		TEENSYDB_FIELD(Reading, Volts),
+		TEENSYDB_FIELD(Reading, Temp),
+		TEENSYDB_FIELD(Reading, Name)> Readings(SSD);
+
+	SSD.init();
+	Readings.begin();
+	SSD.findFirstWritableRecord();
+
+	Readings.save(Now);
+	Readings.read(10, Then);
+
+begin() adds the fields to the TeensyDB object in the same order, so records are byte for byte what addField and
+saveRecord would have written: getField, scan, aggregate, schemas and record checks all work on them. fields can
+be uint8_t, int, int16_t, uint16_t, int32_t, uint32_t, float, double and char arrays, use addBitField and
+saveRecord for bit and scaled fields
+
+*/
+
+#ifndef TEENSYDB_TABLE_H
+#define TEENSYDB_TABLE_H
+
+#include <string.h>
+#include "TeensyDB.h"
+
+// how each type is laid out in a record, the same as encodeRecord and getField
+// the general case is int (where int isn't int32_t, gcc on ARM), any other type won't find an addField
+template <typename M> struct TeensyDBCodec {
+	static const uint16_t Length = sizeof(M);
+	static inline void encode(const M &Data, uint8_t *Bytes) {
+		Bytes[0] = (uint8_t) (Data >> 24);
+		Bytes[1] = (uint8_t) (Data >> 16);
+		Bytes[2] = (uint8_t) (Data >> 8);
+		Bytes[3] = (uint8_t) Data;
+	}
+	static inline void decode(const uint8_t *Bytes, M &Data) {
+		Data = (M) (((uint32_t) Bytes[0] << 24) | ((uint32_t) Bytes[1] << 16) | ((uint32_t) Bytes[2] << 8) | Bytes[3]);
+	}
+	static inline uint8_t add(TeensyDB &DB, M &Data) { return DB.addField(&Data); }
+};
+
+template <> struct TeensyDBCodec<uint8_t> {
+	static const uint16_t Length = 1;
+	static inline void encode(const uint8_t &Data, uint8_t *Bytes) { Bytes[0] = Data; }
+	static inline void decode(const uint8_t *Bytes, uint8_t &Data) { Data = Bytes[0]; }
+	static inline uint8_t add(TeensyDB &DB, uint8_t &Data) { return DB.addField(&Data); }
+};
+
+template <> struct TeensyDBCodec<uint16_t> {
+	static const uint16_t Length = 2;
+	static inline void encode(const uint16_t &Data, uint8_t *Bytes) {
+		Bytes[0] = (uint8_t) (Data >> 8);
+		Bytes[1] = (uint8_t) Data;
+	}
+	static inline void decode(const uint8_t *Bytes, uint16_t &Data) { Data = (Bytes[0] << 8) | Bytes[1]; }
+	static inline uint8_t add(TeensyDB &DB, uint16_t &Data) { return DB.addField(&Data); }
+};
+
+template <> struct TeensyDBCodec<int16_t> {
+	static const uint16_t Length = 2;
+	static inline void encode(const int16_t &Data, uint8_t *Bytes) { TeensyDBCodec<uint16_t>::encode((uint16_t) Data, Bytes); }
+	static inline void decode(const uint8_t *Bytes, int16_t &Data) { Data = (int16_t) ((Bytes[0] << 8) | Bytes[1]); }
+	static inline uint8_t add(TeensyDB &DB, int16_t &Data) { return DB.addField(&Data); }
+};
+
+template <> struct TeensyDBCodec<uint32_t> {
+	static const uint16_t Length = 4;
+	static inline void encode(const uint32_t &Data, uint8_t *Bytes) {
+		Bytes[0] = (uint8_t) (Data >> 24);
+		Bytes[1] = (uint8_t) (Data >> 16);
+		Bytes[2] = (uint8_t) (Data >> 8);
+		Bytes[3] = (uint8_t) Data;
+	}
+	static inline void decode(const uint8_t *Bytes, uint32_t &Data) {
+		Data = ((uint32_t) Bytes[0] << 24) | ((uint32_t) Bytes[1] << 16) | ((uint32_t) Bytes[2] << 8) | Bytes[3];
+	}
+	static inline uint8_t add(TeensyDB &DB, uint32_t &Data) { return DB.addField(&Data); }
+};
+
+template <> struct TeensyDBCodec<int32_t> {
+	static const uint16_t Length = 4;
+	static inline void encode(const int32_t &Data, uint8_t *Bytes) { TeensyDBCodec<uint32_t>::encode((uint32_t) Data, Bytes); }
+	static inline void decode(const uint8_t *Bytes, int32_t &Data) {
+		uint32_t Value;
+		TeensyDBCodec<uint32_t>::decode(Bytes, Value);
+		Data = (int32_t) Value;
+	}
+	static inline uint8_t add(TeensyDB &DB, int32_t &Data) { return DB.addField(&Data); }
+};
+
+// floats and doubles are stored as they are in memory
+template <> struct TeensyDBCodec<float> {
+	static const uint16_t Length = 4;
+	static inline void encode(const float &Data, uint8_t *Bytes) { memcpy(Bytes, &Data, 4); }
+	static inline void decode(const uint8_t *Bytes, float &Data) { memcpy(&Data, Bytes, 4); }
+	static inline uint8_t add(TeensyDB &DB, float &Data) { return DB.addField(&Data); }
+};
+
+template <> struct TeensyDBCodec<double> {
+	static const uint16_t Length = 8;
+	static inline void encode(const double &Data, uint8_t *Bytes) { memcpy(Bytes, &Data, 8); }
+	static inline void decode(const uint8_t *Bytes, double &Data) { memcpy(&Data, Bytes, 8); }
+	static inline uint8_t add(TeensyDB &DB, double &Data) { return DB.addField(&Data); }
+};
+
+// char arrays take their whole size, the same as encodeRecord: the string ends at its 0 or the end of the array
+// and the rest is 0. a string that fills the array is stored (and read back) with no 0 on the end
+template <size_t N> struct TeensyDBCodec<char[N]> {
+	static const uint16_t Length = N;
+	static inline void encode(const char (&Data)[N], uint8_t *Bytes) {
+		size_t i = 0;
+		for (i = 0; (i < N) && (Data[i] != '\0'); i++) {
+			Bytes[i] = Data[i];
+		}
+		for (; i < N; i++) {
+			Bytes[i] = '\0';
+		}
+	}
+	static inline void decode(const uint8_t *Bytes, char (&Data)[N]) { memcpy(Data, Bytes, N); }
+	static inline uint8_t add(TeensyDB &DB, char (&Data)[N]) { return DB.addField(Data, N); }
+};
+
+// one member of the struct, use TEENSYDB_FIELD to make these
+template <typename S, typename M, M S::*Member> struct TeensyDBMember {
+	typedef TeensyDBCodec<M> Codec;
+	static const uint16_t Length = Codec::Length;
+	static inline void encode(const S &Record, uint8_t *Bytes) { Codec::encode(Record.*Member, Bytes); }
+	static inline void decode(const uint8_t *Bytes, S &Record) { Codec::decode(Bytes, Record.*Member); }
+	static inline uint8_t add(TeensyDB &DB, S &Record) { return Codec::add(DB, Record.*Member); }
+};
+
+#define TEENSYDB_FIELD(Struct, Member) TeensyDBMember<Struct, decltype(Struct::Member), &Struct::Member>
+
+// the fields one after the other, each starts where the one before ended
+template <typename S, typename... Fields> struct TeensyDBLayout;
+
+template <typename S> struct TeensyDBLayout<S> {
+	static const uint16_t Length = 0;
+	static const uint8_t Count = 0;
+	static inline void encode(const S &, uint8_t *) {}
+	static inline void decode(const uint8_t *, S &) {}
+	static inline bool add(TeensyDB &, S &) { return true; }
+};
+
+template <typename S, typename Field, typename... Rest> struct TeensyDBLayout<S, Field, Rest...> {
+	typedef TeensyDBLayout<S, Rest...> Next;
+	static const uint16_t Length = Field::Length + Next::Length;
+	static const uint8_t Count = 1 + Next::Count;
+	static inline void encode(const S &Record, uint8_t *Bytes) {
+		Field::encode(Record, Bytes);
+		Next::encode(Record, Bytes + Field::Length);
+	}
+	static inline void decode(const uint8_t *Bytes, S &Record) {
+		Field::decode(Bytes, Record);
+		Next::decode(Bytes + Field::Length, Record);
+	}
+	static inline bool add(TeensyDB &DB, S &Record) {
+		return (Field::add(DB, Record) > 0) && Next::add(DB, Record);
+	}
+};
+
+template <typename S, typename... Fields> class TeensyDBTable {
+
+public:
+
+	typedef TeensyDBLayout<S, Fields...> Layout;
+
+	// bytes of one record, not counting the record check (if used)
+	static const uint16_t Length = Layout::Length;
+
+	TeensyDBTable(TeensyDB &UserDB) : DB(UserDB), Scratch() {}
+
+	// method to add the fields to the TeensyDB object, call after init (and setTable / setSchema) and before
+	// setRecordCheck and findFirstWritableRecord. false if the fields didn't fit, then none are added
+	bool begin() {
+		if (((DB.getFieldCount() + Layout::Count) >= MAX_FIELDS) ||
+			((DB.getRecordLength() + Length) > TEENSYDB_MAXREXORDLENGTH)) {
+			return false;
+		}
+		return Layout::add(DB, Scratch);
+	}
+
+	// method to add a record and save it
+	bool save(const S &Record) {
+		uint8_t Bytes[Length];
+		// check before addRecord, a record added and not saved would leave a gap
+		if ((DB.getDataLength() != Length) || (!DB.addRecord())) {
+			return false;
+		}
+		Layout::encode(Record, Bytes);
+		return DB.saveRecord(Bytes, Length);
+	}
+
+	// same, but through the write queue like saveRecordAsync
+	bool saveAsync(const S &Record) {
+		uint8_t Bytes[Length];
+		if ((DB.getDataLength() != Length) || (!DB.addRecord())) {
+			return false;
+		}
+		Layout::encode(Record, Bytes);
+		return DB.saveRecordAsync(Bytes, Length);
+	}
+
+	// method to read a record into Record, false if there is no such record, it failed the record check or the
+	// TeensyDB object has fields other than these (save returns false for that too)
+	bool read(uint32_t Index, S &Record) {
+		const uint8_t *Bytes = NULL;
+		if (DB.getDataLength() != Length) {
+			return false;
+		}
+		Bytes = DB.readRecord(Index);
+		if (Bytes == NULL) {
+			return false;
+		}
+		Layout::decode(Bytes, Record);
+		return true;
+	}
+
+private:
+
+	TeensyDB &DB;
+
+	// addField needs somewhere to point, save() never uses it
+	S Scratch;
+
+};
+
+#endif
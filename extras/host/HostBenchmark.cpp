@@ -0,0 +1,1818 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+/*
+
+host benchmark, runs TeensyDB against the simulated flash chip and reports simulated time and chip commands
+
+build and run from the library folder
+	g++ -O2 -std=gnu++11 -I. -Iextras/host TeensyDB.cpp TeensyDBBus.cpp TeensyDBDevice.cpp TeensyDBChip.cpp extras/host/TeensyDBHost.cpp extras/host/TeensyDBSimFlash.cpp extras/host/HostBenchmark.cpp -o hostbench
+	./hostbench
+	./hostbench -suite -csv (see suite below)
+
+times are bus and chip time on a W25Q64JV at 25 MHz (see TeensyDBSimTiming), not PC time, except the lines marked PC time
+
+*/
+
+#include <chrono>
+#include "TeensyDB.h"
+#include "TeensyDBTable.h"
+#include "TeensyDBSimFlash.h"
+
+#define RECORDS 5000
+#define READ_RECORDS 1000
+
+char Name[12];
+uint8_t ID = 0;
+uint32_t Point = 0;
+float Volts = 0;
+int16_t Temp = 0;
+
+uint8_t fName = 0, fID = 0, fPoint = 0, fVolts = 0, fTemp = 0;
+
+uint32_t ScanCount = 0;
+uint32_t ScanSum = 0;
+
+TeensyDB *Bench;
+
+bool ScanRecord(uint32_t) {
+	
+	ScanCount++;
+	ScanSum = ScanSum + Bench->getField(Point, fPoint);
+	
+	return true;
+	
+}
+
+void addFields(TeensyDB &DB) {
+	
+	fName = DB.addField(Name, sizeof(Name));
+	fID = DB.addField(&ID);
+	fPoint = DB.addField(&Point);
+	fVolts = DB.addField(&Volts);
+	fTemp = DB.addField(&Temp);
+	
+}
+
+void report(const char *Test, TeensyDBSimFlash &Flash, uint64_t Start, uint32_t Records, uint32_t Bytes) {
+	
+	double us = (double) (TeensyDBHostClock - Start) / 1000.0;
+	
+	printf("%-40s %12.0f us %10.2f us/record %12.0f records/s %12.0f bytes/s %8u cmds %8u programs\n",
+		Test, us, us / Records, (Records * 1000000.0) / us, (Bytes * 1000000.0) / us,
+		Flash.Counters.Transactions, Flash.Counters.Programs);
+	
+}
+
+void writeTest(const char *Test, bool Combine) {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	uint64_t Start = 0;
+	uint32_t i = 0;
+	
+	DB.init();
+	addFields(DB);
+	DB.findFirstWritableRecord();
+	DB.setWriteCombine(Combine);
+	
+	strcpy(Name, "Bench");
+	
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	
+	for (i = 0; i < RECORDS; i++) {
+		ID = i & 0xFF;
+		Point = i;
+		Volts = i * 0.01f;
+		Temp = i & 0x7FFF;
+		DB.addRecord();
+		DB.saveRecord();
+	}
+	DB.flush();
+	
+	report(Test, Flash, Start, RECORDS, RECORDS * DB.getRecordLength());
+	
+	if (Flash.Counters.ProgramViolations || Flash.Counters.BusyViolations) {
+		printf("  chip rule violations: program %u, busy %u\n", Flash.Counters.ProgramViolations, Flash.Counters.BusyViolations);
+	}
+	
+}
+
+void readTests() {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	uint64_t Start = 0;
+	uint32_t i = 0;
+	uint32_t j = 0;
+	uint32_t Sum = 0;
+	uint8_t Byte = 0;
+	uint8_t Lanes = 0;
+	uint8_t Fields[3];
+	double VoltsSum = 0;
+	TeensyDBAggregate Stats[3];
+	
+	DB.init();
+	addFields(DB);
+	DB.findFirstWritableRecord();
+	DB.setWriteCombine(true);
+	
+	for (i = 0; i < READ_RECORDS; i++) {
+		Point = i;
+		Volts = (i % 100) * 0.5f;
+		Temp = (int16_t) (i % 200) - 100;
+		DB.addRecord();
+		DB.saveRecord();
+	}
+	DB.flush();
+	
+	Fields[0] = fPoint;
+	Fields[1] = fVolts;
+	Fields[2] = fTemp;
+	
+	// the way getField used to work, a read command and a status check for every byte of every field
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	for (i = 1; i <= READ_RECORDS; i++) {
+		for (j = 0; j < DB.getRecordLength(); j++) {
+			Flash.readStatus();
+			Flash.read((i * DB.getRecordLength()) + j, &Byte, 1);
+			Sum = Sum + Byte;
+		}
+	}
+	report("read every field, byte per command", Flash, Start, READ_RECORDS, READ_RECORDS * DB.getRecordLength());
+	
+	// one FASTREAD per record, fields served from the record buffer
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	for (i = 1; i <= READ_RECORDS; i++) {
+		DB.gotoRecord(i);
+		DB.getCharField(fName);
+		Sum = Sum + DB.getField(ID, fID);
+		Sum = Sum + DB.getField(Point, fPoint);
+		DB.getField(Volts, fVolts);
+		DB.getField(Temp, fTemp);
+	}
+	report("read every field, record buffer", Flash, Start, READ_RECORDS, READ_RECORDS * DB.getRecordLength());
+	
+	// many records per FASTREAD
+	Bench = &DB;
+	ScanCount = 0;
+	ScanSum = 0;
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	DB.scan(1, READ_RECORDS, ScanRecord);
+	report("scan", Flash, Start, READ_RECORDS, READ_RECORDS * DB.getRecordLength());
+	
+	if ((ScanCount != READ_RECORDS) || (ScanSum != (READ_RECORDS * (READ_RECORDS - 1)) / 2)) {
+		printf("  scan check failed: %u records, sum %u\n", ScanCount, ScanSum);
+	}
+	
+	// same scan with the data phase on 2 and 4 lines
+	for (Lanes = 2; Lanes <= 4; Lanes = Lanes * 2) {
+		DB.setReadLanes(Lanes);
+		ScanCount = 0;
+		ScanSum = 0;
+		Flash.resetCounters();
+		Start = TeensyDBHostClock;
+		DB.scan(1, READ_RECORDS, ScanRecord);
+		report((Lanes == 2) ? "scan, dual output read" : "scan, quad output read", Flash, Start, READ_RECORDS, READ_RECORDS * DB.getRecordLength());
+		if ((ScanCount != READ_RECORDS) || (ScanSum != (READ_RECORDS * (READ_RECORDS - 1)) / 2)) {
+			printf("  scan check failed: %u records, sum %u\n", ScanCount, ScanSum);
+		}
+	}
+	DB.setReadLanes(1);
+	
+	// statistics for 3 fields, getField record by record then aggregate in one pass
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	for (i = 1; i <= READ_RECORDS; i++) {
+		DB.gotoRecord(i);
+		Sum = Sum + DB.getField(Point, fPoint);
+		VoltsSum = VoltsSum + DB.getField(Volts, fVolts);
+		Sum = Sum + DB.getField(Temp, fTemp);
+	}
+	report("stats of 3 fields, getField", Flash, Start, READ_RECORDS, READ_RECORDS * DB.getRecordLength());
+	
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	DB.aggregate(Fields, 3, Stats, 1, READ_RECORDS);
+	report("stats of 3 fields, aggregate", Flash, Start, READ_RECORDS, READ_RECORDS * DB.getRecordLength());
+	
+	if ((Stats[0].Count != READ_RECORDS) || (Stats[0].Min != 0) || (Stats[0].Max != (READ_RECORDS - 1)) ||
+		(Stats[0].Mean != ((READ_RECORDS - 1) / 2.0)) || (Stats[1].Sum != VoltsSum) || (Stats[2].Min != -100) ||
+		(Stats[2].Max != 99) || (fabs(Stats[0].StdDev - 288.8194) > 0.001)) {
+		printf("  aggregate check failed: %u records, mean %f, sum %f, std dev %f\n", Stats[0].Count, Stats[0].Mean, Stats[1].Sum, Stats[0].StdDev);
+	}
+	
+	// a bad field anywhere in the list reads nothing and leaves every result at 0
+	Fields[0] = fName;
+	memset(Stats, 0xFF, sizeof(Stats));
+	if ((DB.aggregate(Fields, 3, Stats, 1, READ_RECORDS) != 0) || (Stats[0].Count != 0) || (Stats[0].Max != 0) ||
+		(Stats[1].Sum != 0) || (Stats[2].Count != 0) || (Stats[2].StdDev != 0)) {
+		printf("  aggregate check failed: a bad field left results set\n");
+	}
+	Fields[0] = fPoint;
+	
+}
+
+void chipTest(uint8_t Manufacturer, uint8_t Type, uint8_t Capacity) {
+	
+	TeensyDBSimFlash Flash(Manufacturer, Type, Capacity);
+	TeensyDB DB(Flash);
+	uint32_t Records = 0;
+	uint32_t Found = 0;
+	
+	DB.init();
+	addFields(DB);
+	
+	// fill 3/4 of the chip directly (record 0 is never used), then see if the bisect finds the end
+	// on the big chips this puts the end past 16 MB so the 4 byte address path is checked
+	Records = ((Flash.getSize() / 4) * 3) / DB.getRecordLength();
+	memset(Flash.getMemory() + DB.getRecordLength(), 0x00, Records * DB.getRecordLength());
+	
+	Found = DB.findFirstWritableRecord();
+	
+	printf("%-12s %-12s %8u bytes  %7u records  bisect %s\n", DB.getChipJEDEC(), DB.getChipName(), DB.getTotalSpace(),
+		DB.getTotalSpace() / DB.getRecordLength(), (Found == Records) ? "ok" : "FAILED");
+	
+}
+
+void bootTest(const char *Test, uint16_t Interval) {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	TeensyDB Reboot(Flash);
+	uint64_t Start = 0;
+	uint32_t Found = 0;
+	uint32_t i = 0;
+	
+	DB.init();
+	addFields(DB);
+	DB.setCheckpoint(Interval);
+	DB.findFirstWritableRecord();
+	DB.setWriteCombine(true);
+	
+	// enough records to roll the checkpoint log over to its second sector
+	for (i = 0; i < 40000; i++) {
+		Point = i;
+		DB.addRecord();
+		DB.saveRecord();
+	}
+	DB.flush();
+	
+	Reboot.init();
+	addFields(Reboot);
+	Reboot.setCheckpoint(Interval);
+	
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	Found = Reboot.findFirstWritableRecord();
+	
+	printf("%-40s %12.0f us %8u cmds  found %u %s\n", Test, (double) (TeensyDBHostClock - Start) / 1000.0,
+		Flash.Counters.Transactions, Found, (Found == 40000) ? "ok" : "FAILED");
+	
+}
+
+void keyTest(const char *Test, bool Index) {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	uint64_t Start = 0;
+	uint32_t Found = 0;
+	uint32_t Seeks = 0;
+	uint32_t i = 0;
+	bool Ok = true;
+	
+	DB.init();
+	addFields(DB);
+	DB.findFirstWritableRecord();
+	DB.setWriteCombine(true);
+	DB.setKeyField(fPoint, Index);
+	
+	// Point is a time stamp, 3 ms apart
+	for (i = 1; i <= 40000; i++) {
+		Point = i * 3;
+		DB.addRecord();
+		DB.saveRecord();
+	}
+	DB.flush();
+	
+	if (Index) {
+		DB.buildKeyIndex();
+	}
+	
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	
+	// exact keys, keys between records, before the first and past the last
+	for (i = 0; i < 120010; i = i + 997) {
+		Found = DB.seekKey(i);
+		Seeks++;
+		if (Found != ((i > 120000) ? 0 : (i == 0) ? 1 : ((i + 2) / 3))) {
+			Ok = false;
+		}
+	}
+	
+	printf("%-40s %12.2f us/seek %8.1f cmds/seek", Test, (double) (TeensyDBHostClock - Start) / (1000.0 * Seeks),
+		(double) Flash.Counters.Transactions / Seeks);
+	
+	// time range, one minute from t = 60 s
+	Bench = &DB;
+	ScanCount = 0;
+	if ((DB.scanKeys(60000, 119999, ScanRecord) != 20000) || (ScanCount != 20000)) {
+		Ok = false;
+	}
+	
+	printf(" %s\n", Ok ? "ok" : "FAILED");
+	
+}
+
+void zoneTest(const char *Test, bool Zone) {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	TeensyDB Reboot(Flash);
+	TeensyDB *Writer = &DB;
+	uint64_t Start = 0;
+	uint32_t Found = 0;
+	uint32_t i = 0;
+	
+	DB.init();
+	addFields(DB);
+	DB.setZoneMap(Zone);
+	DB.findFirstWritableRecord();
+	DB.setWriteCombine(true);
+	
+	// a temperature log that only runs hot now and then, 50 records every 20000
+	for (i = 1; i <= 100000; i++) {
+		
+		// reboot part way through a sector, the zone map has to pick up where it was
+		if (i == 50037) {
+			DB.flush();
+			Reboot.init();
+			addFields(Reboot);
+			Reboot.setZoneMap(Zone);
+			Reboot.findFirstWritableRecord();
+			Reboot.setWriteCombine(true);
+			Writer = &Reboot;
+		}
+		
+		Point = i;
+		Temp = ((i % 20000) < 50) ? 2000 : (i % 500);
+		Writer->addRecord();
+		Writer->saveRecord();
+	}
+	Writer->flush();
+	
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	
+	Bench = Writer;
+	ScanCount = 0;
+	Found = Writer->scanWhere(fTemp, 1000, INFINITY, ScanRecord);
+	
+	printf("%-40s %12.0f us %8u cmds  found %u %s\n", Test, (double) (TeensyDBHostClock - Start) / 1000.0,
+		Flash.Counters.Transactions, Found, ((Found == 250) && (ScanCount == 250)) ? "ok" : "FAILED");
+	
+}
+
+uint32_t CompressErrors = 0;
+
+bool CompressRecord(uint32_t Record) {
+	
+	// Point was saved as the record number, Temp as a slow triangle wave
+	if ((Bench->getField(Point, fPoint) != Record) || (Bench->getField(Temp, fTemp) != (int16_t) (((Record / 8) % 200) - 100))) {
+		CompressErrors++;
+	}
+	
+	return true;
+	
+}
+
+void compressTest(const char *Test, bool Compress) {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	TeensyDB Reboot(Flash);
+	uint64_t Start = 0;
+	uint32_t Found = 0;
+	uint32_t i = 0;
+	uint32_t Seed = 1;
+	uint32_t Bytes = 0;
+	double Write = 0;
+	
+	DB.init();
+	addFields(DB);
+	DB.setCompression(Compress);
+	DB.findFirstWritableRecord();
+	DB.setWriteCombine(true);
+	
+	// a logged sensor, a sample counter, a 12 bit ADC reading in volts with a little noise,
+	// a slow temperature and a run name that never changes
+	strcpy(Name, "Run 12");
+	ID = 3;
+	
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	for (i = 1; i <= 20000; i++) {
+		Seed = (Seed * 1103515245) + 12345;
+		Point = i;
+		Volts = (2048 + ((i / 50) % 400) + ((Seed >> 16) % 4)) * (3.3f / 4096.0f);
+		Temp = (int16_t) (((i / 8) % 200) - 100);
+		DB.addRecord();
+		DB.saveRecord();
+	}
+	DB.flush();
+	Write = (double) (TeensyDBHostClock - Start) / 1000.0;
+	Bytes = DB.getUsedSpace();
+	
+	// a fresh start has to find the end and carry on
+	Reboot.init();
+	addFields(Reboot);
+	Reboot.setCompression(Compress);
+	Found = Reboot.findFirstWritableRecord();
+	Reboot.setWriteCombine(true);
+	
+	for (i = 20001; i <= 20500; i++) {
+		Point = i;
+		Temp = (int16_t) (((i / 8) % 200) - 100);
+		Reboot.addRecord();
+		Reboot.saveRecord();
+	}
+	Reboot.flush();
+	
+	Bench = &Reboot;
+	CompressErrors = 0;
+	if (Reboot.scan(1, Reboot.getLastRecord(), CompressRecord) != 20500) {
+		CompressErrors++;
+	}
+	
+	// random reads
+	Flash.resetCounters();
+	for (i = 0; i < 100; i++) {
+		Seed = (Seed * 1103515245) + 12345;
+		Reboot.gotoRecord(((Seed >> 8) % 20000) + 1);
+		if (Reboot.getField(Point, fPoint) != Reboot.getCurrentRecord()) {
+			CompressErrors++;
+		}
+	}
+	
+	printf("%-40s %10u bytes %6.2f : 1 %12.0f records/s %6.1f cmds/random read  found %u %s\n", Test, Bytes,
+		(20000.0 * DB.getRecordLength()) / Bytes, 20000000000.0 / Write, Flash.Counters.Transactions / 100.0,
+		Found, ((Found == 20000) && (CompressErrors == 0)) ? "ok" : "FAILED");
+	
+}
+
+void bitTest(const char *Test, bool Packed) {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	uint64_t Start = 0;
+	uint32_t Time = 0;
+	bool Pump = false, Valve = false, Alarm = false;
+	uint16_t ADC[4];
+	float Pressure = 0;
+	uint8_t fTime = 0, fPump = 0, fValve = 0, fAlarm = 0, fADC[4], fPressure = 0;
+	uint32_t Errors = 0;
+	uint32_t i = 0;
+	uint8_t k = 0;
+	
+	DB.init();
+	
+	// a controller log, time, 3 flags, 4 12 bit ADC channels and a pressure 0 to 10 bar to 0.01 bar
+	fTime = DB.addField(&Time);
+	if (Packed) {
+		fPump = DB.addBitField(&Pump);
+		fValve = DB.addBitField(&Valve);
+		fAlarm = DB.addBitField(&Alarm);
+		for (k = 0; k < 4; k++) {
+			fADC[k] = DB.addBitField(&ADC[k], 12);
+		}
+		fPressure = DB.addScaledField(&Pressure, 0.01f, 0.0f, 10);
+	}
+	else {
+		fPump = DB.addField((uint8_t *) &Pump);
+		fValve = DB.addField((uint8_t *) &Valve);
+		fAlarm = DB.addField((uint8_t *) &Alarm);
+		for (k = 0; k < 4; k++) {
+			fADC[k] = DB.addField(&ADC[k]);
+		}
+		fPressure = DB.addField(&Pressure);
+	}
+	
+	DB.findFirstWritableRecord();
+	DB.setWriteCombine(true);
+	
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	for (i = 1; i <= RECORDS; i++) {
+		Time = i * 10;
+		Pump = (i % 3) == 0;
+		Valve = (i % 7) < 2;
+		Alarm = (i % 101) == 0;
+		for (k = 0; k < 4; k++) {
+			ADC[k] = (i * (k + 1) * 37) & 0x0FFF;
+		}
+		Pressure = (i % 1000) * 0.01f;
+		DB.addRecord();
+		DB.saveRecord();
+	}
+	DB.flush();
+	report(Test, Flash, Start, RECORDS, RECORDS * DB.getRecordLength());
+	
+	for (i = 1; i <= RECORDS; i++) {
+		DB.gotoRecord(i);
+		if ((DB.getField(Time, fTime) != (i * 10)) || (DB.getField((uint8_t) 0, fPump) != ((i % 3) == 0)) ||
+			(DB.getField((uint8_t) 0, fValve) != ((i % 7) < 2)) || (DB.getField((uint8_t) 0, fAlarm) != ((i % 101) == 0)) ||
+			(fabs(DB.getField(Pressure, fPressure) - ((i % 1000) * 0.01f)) > 0.006)) {
+			Errors++;
+		}
+		for (k = 0; k < 4; k++) {
+			if (DB.getField(ADC[k], fADC[k]) != ((i * (k + 1) * 37) & 0x0FFF)) {
+				Errors++;
+			}
+		}
+	}
+	
+	// the signed and double getField read bit and scaled fields too
+	DB.gotoRecord(RECORDS);
+	if (Packed && ((DB.getField((int16_t) 0, fADC[0]) != (int16_t) ((RECORDS * 37) & 0x0FFF)) ||
+		(DB.getField((int32_t) 0, fADC[1]) != (int32_t) ((RECORDS * 2 * 37) & 0x0FFF)) ||
+		(fabs(DB.getField(0.0, fPressure) - ((RECORDS % 1000) * 0.01)) > 0.006))) {
+		Errors++;
+	}
+	
+	printf("  %u byte records, %u records fit, read back %s\n", DB.getRecordLength(), DB.getTotalSpace() / DB.getRecordLength(),
+		(Errors == 0) ? "ok" : "FAILED");
+	
+}
+
+void tornTest() {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	TeensyDB Reboot(Flash);
+	uint64_t Start = 0;
+	uint32_t Found = 0;
+	uint32_t Length = 0;
+	uint32_t i = 0;
+	bool Ok = true;
+	
+	DB.init();
+	addFields(DB);
+	DB.setRecordCheck(true);
+	DB.findFirstWritableRecord();
+	
+	for (i = 1; i <= 1000; i++) {
+		Point = i;
+		DB.addRecord();
+		DB.saveRecord();
+	}
+	
+	// power lost part way through record 1001, only the first 10 bytes made it
+	Length = DB.getRecordLength();
+	memcpy(Flash.getMemory() + (1001 * Length), Flash.getMemory() + (1000 * Length), 10);
+	
+	Reboot.init();
+	addFields(Reboot);
+	Reboot.setRecordCheck(true);
+	
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	Found = Reboot.findFirstWritableRecord();
+	
+	printf("%-40s %12.0f us %8u cmds  found %u, %u bad", "find end of 1000 records, torn last record",
+		(double) (TeensyDBHostClock - Start) / 1000.0, Flash.Counters.Transactions, Found, Reboot.getBadRecords());
+	
+	Ok = (Found == 1001) && (Reboot.getBadRecords() == 1);
+	
+	// the torn record is skipped, logging carries on after it
+	Point = 1002;
+	Reboot.addRecord();
+	Reboot.saveRecord();
+	
+	Bench = &Reboot;
+	ScanCount = 0;
+	ScanSum = 0;
+	Reboot.scan(1, Reboot.getLastRecord(), ScanRecord);
+	Reboot.gotoRecord(1001);
+	
+	Ok = Ok && (ScanCount == 1001) && (ScanSum == ((1000 * 1001) / 2) + 1002) && (!Reboot.isRecordValid()) &&
+		(Reboot.getField(Point, fPoint) == 0);
+	
+	// reading the torn record again doesn't count it again, a verify pass counts it once
+	Reboot.scan(1, Reboot.getLastRecord(), ScanRecord);
+	Ok = Ok && (Reboot.getBadRecords() == 1) && (Reboot.verifyRecords() == 1) && (Reboot.getBadRecords() == 1);
+	
+	printf(" %s\n", Ok ? "ok" : "FAILED");
+	
+}
+
+uint32_t RingNext = 0;
+bool RingOrder = true;
+
+bool RingRecord(uint32_t Record) {
+	
+	// Point was saved as the record number
+	if ((Bench->getField(Point, fPoint) != Record) || (Record != RingNext)) {
+		RingOrder = false;
+	}
+	RingNext = Record + 1;
+	
+	return true;
+	
+}
+
+void ringTest(const char *Test, uint8_t Type, uint8_t Capacity, uint32_t Records, uint32_t Interval) {
+	
+	// small chip so it wraps a few times
+	TeensyDBSimFlash Flash(Type == 0x06 ? 0x62 : 0xEF, Type, Capacity);
+	TeensyDB DB(Flash);
+	TeensyDB Reboot(Flash);
+	uint64_t Start = 0;
+	uint64_t Worst = 0;
+	uint32_t Found = 0;
+	uint32_t i = 0;
+	bool Gone = false;
+	
+	DB.init();
+	addFields(DB);
+	DB.setRingMode(true);
+	DB.findFirstWritableRecord();
+	
+	Flash.resetCounters();
+	
+	for (i = 1; i <= Records; i++) {
+		Point = i;
+		Start = TeensyDBHostClock;
+		DB.addRecord();
+		DB.saveRecordAsync();
+		if ((TeensyDBHostClock - Start) > Worst) {
+			Worst = TeensyDBHostClock - Start;
+		}
+		// the acquisition loop, Interval us between records
+		TeensyDBHostClock = TeensyDBHostClock + (Interval * 1000ULL);
+		DB.poll();
+	}
+	DB.flush();
+	while (DB.poll()) {
+	}
+	
+	Reboot.init();
+	addFields(Reboot);
+	Reboot.setRingMode(true);
+	Found = Reboot.findFirstWritableRecord();
+	
+	Bench = &Reboot;
+	RingNext = Reboot.getFirstRecord();
+	RingOrder = true;
+	Reboot.scan(Reboot.getFirstRecord(), Reboot.getLastRecord(), RingRecord);
+	
+	// the record before the first has been written over, there's nothing to read
+	Gone = (Reboot.getFirstRecord() > 1) && (Reboot.readRecord(Reboot.getFirstRecord() - 1) == NULL) &&
+		(!Reboot.getRecord(Reboot.getFirstRecord() - 1).isValid()) && (Reboot.readRecord(Reboot.getFirstRecord()) != NULL);
+	
+	printf("%-40s %8.0f us worst save  %u sector erases  found %u, first %u %s\n", Test,
+		(double) Worst / 1000.0, Flash.Counters.SectorErases, Found, Reboot.getFirstRecord(),
+		(Gone && (Found == Records) && RingOrder && (RingNext == (Records + 1)) && (Flash.Counters.ProgramViolations == 0) &&
+		(Flash.Counters.SuspendViolations == 0)) ? "ok" : "FAILED");
+	
+}
+
+void powerTest(const char *Test, uint8_t Type, uint8_t Capacity, bool Drain) {
+	
+	// ring mode a lap and a half round the chip, then the power goes right after the first record of a sector
+	// while the erase of the sector after it is still going. without suspend the record waits for that erase, so
+	// the power goes before it is on the chip. with Drain the record goes out with the erase suspended, so the
+	// head is in front of a half erased sector and the next boot has to erase it again
+	TeensyDBSimFlash Flash(Type == 0x06 ? 0x62 : 0xEF, Type, Capacity);
+	TeensyDB DB(Flash);
+	TeensyDB Reboot(Flash);
+	TeensyDB Check(Flash);
+	uint32_t PerSector = 0;
+	uint32_t Records = 0;
+	uint32_t Found = 0;
+	uint32_t i = 0;
+	bool Cut = false;
+	
+	DB.init();
+	addFields(DB);
+	DB.setRingMode(true);
+	DB.findFirstWritableRecord();
+	
+	PerSector = 4096 / DB.getRecordLength();
+	Records = ((((Flash.getSize() / 4096) * 3) / 2) * PerSector) + 1;
+	
+	for (i = 1; i <= Records; i++) {
+		Point = i;
+		DB.addRecord();
+		DB.saveRecordAsync();
+		TeensyDBHostClock = TeensyDBHostClock + 100000;
+		DB.poll();
+	}
+	
+	// with erase suspend the record can go out with the erase suspended, let it
+	while (Drain && (DB.getQueueDepth() > 0)) {
+		TeensyDBHostClock = TeensyDBHostClock + 100000;
+		DB.poll();
+	}
+	TeensyDBHostClock = TeensyDBHostClock + 1000000;
+	Cut = Flash.isSuspended();
+	Flash.powerLoss();
+	Flash.resetCounters();
+	
+	Reboot.init();
+	addFields(Reboot);
+	Reboot.setRingMode(true);
+	Found = Reboot.findFirstWritableRecord();
+	
+	// two more sectors, over the one the erase was cut short in
+	for (i = Found + 1; i <= (Found + (2 * PerSector)); i++) {
+		Point = i;
+		Reboot.addRecord();
+		Reboot.saveRecordAsync();
+		TeensyDBHostClock = TeensyDBHostClock + 100000;
+		Reboot.poll();
+	}
+	Reboot.flush();
+	while (Reboot.poll()) {
+	}
+	
+	Check.init();
+	addFields(Check);
+	Check.setRingMode(true);
+	Check.findFirstWritableRecord();
+	
+	Bench = &Check;
+	RingNext = Check.getFirstRecord();
+	RingOrder = true;
+	Check.scan(Check.getFirstRecord(), Check.getLastRecord(), RingRecord);
+	
+	printf("%-40s found %u of %u  %u written after  %u program violations %s\n", Test, Found, Records, i - Found - 1,
+		Flash.Counters.ProgramViolations, ((Cut == Drain) && (Found >= (Records - 1)) && RingOrder && (RingNext == i) && (Check.getLastRecord() == (i - 1)) &&
+		(Flash.Counters.ProgramViolations == 0) && (Flash.Counters.SuspendViolations == 0)) ? "ok" : "FAILED");
+	
+}
+
+void eraseTest(const char *Test, uint8_t Type, uint8_t Capacity, bool Async) {
+	
+	// old data in the top half of the chip is cleared while logging carries on at the bottom
+	TeensyDBSimFlash Flash(Type == 0x06 ? 0x62 : 0xEF, Type, Capacity);
+	TeensyDB DB(Flash);
+	uint32_t Sectors = Flash.getSize() / 2 / 4096;
+	uint64_t Start = 0;
+	uint64_t Worst = 0;
+	uint64_t Took = 0;
+	uint32_t Records = 0;
+	uint32_t i = 0;
+	bool Ok = true;
+	
+	// the SST part erases a block in 100 ms
+	if (Type == 0x06) {
+		Flash.Timing.SmallBlockEraseUs = 100000;
+		Flash.Timing.LargeBlockEraseUs = 100000;
+	}
+	
+	DB.init();
+	addFields(DB);
+	DB.findFirstWritableRecord();
+	memset(Flash.getMemory() + (Sectors * 4096), 0x00, Sectors * 4096);
+	
+	Flash.resetCounters();
+	Took = TeensyDBHostClock;
+	DB.eraseAsync(Sectors, Sectors);
+	
+	while (DB.getErasePending() > 0) {
+		Records++;
+		Point = Records;
+		Start = TeensyDBHostClock;
+		DB.addRecord();
+		if (Async) {
+			DB.saveRecordAsync();
+		}
+		else {
+			DB.saveRecord();
+		}
+		if ((TeensyDBHostClock - Start) > Worst) {
+			Worst = TeensyDBHostClock - Start;
+		}
+		// the acquisition loop, 100 us between records
+		TeensyDBHostClock = TeensyDBHostClock + 100000;
+		DB.poll();
+	}
+	Took = TeensyDBHostClock - Took;
+	DB.flush();
+	
+	for (i = Sectors * 4096; i < Flash.getSize(); i++) {
+		if (Flash.getMemory()[i] != 0xFF) {
+			Ok = false;
+			break;
+		}
+	}
+	
+	Bench = &DB;
+	RingNext = 1;
+	RingOrder = true;
+	DB.scan(1, DB.getLastRecord(), RingRecord);
+	
+	printf("%-40s %8.0f us worst save  %6.0f ms to erase  %u records  %u suspends %s\n", Test, (double) Worst / 1000.0,
+		(double) Took / 1000000.0, Records, Flash.Counters.Suspends,
+		(Ok && RingOrder && (RingNext == (Records + 1)) && (DB.getErasePending() == 0) && (Flash.Counters.BusyViolations == 0) &&
+		(Flash.Counters.SuspendViolations == 0) && (Flash.Counters.ProgramViolations == 0)) ? "ok" : "FAILED");
+	
+}
+
+// upper end of the histogram bucket that Percent of the times are in or under, us
+uint32_t percentile(const TeensyDBHistogram &Histogram, double Percent) {
+	
+	uint32_t Sum = 0;
+	uint8_t b = 0;
+	
+	for (b = 0; b < TEENSYDB_HISTOGRAM; b++) {
+		Sum = Sum + Histogram.Bucket[b];
+		if (Sum >= (Histogram.Count * Percent / 100.0)) {
+			break;
+		}
+	}
+	
+	return (1UL << b) - 1;
+	
+}
+
+void statsTest() {
+	
+	// the ring test again, this time read back from getStats instead of timed around each call
+	TeensyDBSimFlash Flash(0x62, 0x06, 0x13);
+	TeensyDB DB(Flash);
+	TeensyDBStats Stats;
+	uint32_t i = 0;
+	bool Ok = true;
+	
+#ifdef TEENSYDB_NO_STATS
+	printf("%-40s built with TEENSYDB_NO_STATS\n", "ring, 60000 records, getStats");
+	return;
+#endif
+	
+	DB.init();
+	addFields(DB);
+	DB.setRingMode(true);
+	DB.findFirstWritableRecord();
+	
+	Flash.resetCounters();
+	DB.resetStats();
+	
+	for (i = 1; i <= 60000; i++) {
+		Point = i;
+		DB.addRecord();
+		DB.saveRecordAsync();
+		TeensyDBHostClock = TeensyDBHostClock + 100000;
+		DB.poll();
+	}
+	DB.flush();
+	DB.findFirstWritableRecord();
+	
+	Stats = DB.getStats();
+	
+	// every command the chip saw was counted
+	Ok = (Stats.Reads == Flash.Counters.Reads) && (Stats.ReadBytes == Flash.Counters.ReadBytes) &&
+		(Stats.Programs == Flash.Counters.Programs) && (Stats.ProgramBytes == Flash.Counters.ProgramBytes) &&
+		(Stats.Erases == Flash.Counters.SectorErases) && (Stats.StatusPolls == Flash.Counters.StatusPolls) &&
+		(Stats.Timeouts == 0) && (Stats.Latency[LATENCY_SAVEASYNC].Count == 60000) && (Stats.Latency[LATENCY_FIND].Count == 1);
+	
+	printf("%-40s %8u us worst save  %6u us 99%%  %6u us worst erase wait  %u cmds %s\n", "ring, 60000 records, getStats",
+		Stats.Latency[LATENCY_SAVEASYNC].Max, percentile(Stats.Latency[LATENCY_SAVEASYNC], 99.0), Stats.Latency[LATENCY_ERASE].Max,
+		Stats.Transactions, Ok ? "ok" : "FAILED");
+	
+}
+
+double SchemaSum = 0;
+uint8_t SchemaPoint = 0;
+
+bool SchemaRecord(uint32_t) {
+	
+	// the reader knows nothing about the fields, Point is found by name
+	SchemaSum = SchemaSum + Bench->getFieldValue(SchemaPoint);
+	
+	return true;
+	
+}
+
+void schemaTest() {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	TeensyDB Reader(Flash);
+	TeensyDB Other(Flash);
+	TeensyDBSimFlash WideFlash;
+	TeensyDB Wide(WideFlash);
+	TeensyDB WideBoot(WideFlash);
+	TeensyDB Plain(WideFlash);
+	uint8_t Bits[MAX_FIELDS];
+	uint16_t Limit = 0;
+	int16_t Wides = 0;
+	uint64_t Start = 0;
+	bool Pump = false;
+	uint16_t ADC = 0;
+	int16_t Count = 0;
+	int32_t Result = 0;
+	uint32_t i = 0;
+	uint8_t f = 0;
+	bool Ok = true;
+	
+	DB.init();
+	DB.setSchema(true);
+	DB.setCheckpoint(64);
+	addFields(DB);
+	DB.addBitField(&Pump);
+	DB.addBitField(&ADC, 12);
+	DB.setRecordCheck(true);
+	DB.setFieldName(fName, "Name");
+	DB.setFieldName(fPoint, "Point");
+	DB.setFieldName(fVolts, "Volts");
+	DB.setFieldName(fTemp, "Temp");
+	DB.findFirstWritableRecord();
+	
+	for (i = 1; i <= RECORDS; i++) {
+		Point = i;
+		Volts = i * 0.5f;
+		ADC = i & 0x0FFF;
+		DB.addRecord();
+		DB.saveRecord();
+	}
+	DB.flush();
+	
+	// a generic reader builds the field table from the chip
+	Reader.init();
+	Count = Reader.loadSchema();
+	
+	SchemaPoint = 0;
+	for (f = 1; f <= Count; f++) {
+		if (strcmp(Reader.getFieldName(f), "Point") == 0) {
+			SchemaPoint = f;
+		}
+	}
+	Reader.findFirstWritableRecord();
+	
+	Bench = &Reader;
+	SchemaSum = 0;
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	Reader.scan(1, Reader.getLastRecord(), SchemaRecord);
+	report("scan 5000 records, loaded schema", Flash, Start, RECORDS, RECORDS * Reader.getRecordLength());
+	
+	Reader.gotoRecord(RECORDS);
+	Ok = (Count == 7) && (Reader.getRecordLength() == DB.getRecordLength()) && (Reader.getLastRecord() == RECORDS) &&
+		(SchemaSum == ((double) RECORDS * (RECORDS + 1)) / 2.0) && (Reader.getFieldValue(7) == (RECORDS & 0x0FFF)) &&
+		(Reader.getFieldValue(4) == RECORDS * 0.5) && (Reader.getFieldType(6) == DT_BITS8) && (!Reader.addRecord());
+	
+	// a logger with another field list is turned away
+	Other.init();
+	Other.setSchema(true);
+	Other.setCheckpoint(64);
+	addFields(Other);
+	Other.setRecordCheck(true);
+	Result = (int32_t) Other.findFirstWritableRecord();
+	
+	Ok = Ok && (Result == SCHEMA_MISMATCH) && (!Other.addRecord()) && (!Other.saveRecord());
+	
+	// the schema holds (TEENSYDB_SCANBUFFER - 16) / 16 fields, addField stops there and the chip still takes the
+	// list. build with -DMAX_FIELDS=255 to go past it
+	Limit = (TEENSYDB_SCANBUFFER - 16) / 16;
+	if (Limit > (MAX_FIELDS - 1)) {
+		Limit = MAX_FIELDS - 1;
+	}
+	memset(Bits, 0, sizeof(Bits));
+	Wide.init();
+	Wide.setSchema(true);
+	for (f = 0; f < (MAX_FIELDS - 1); f++) {
+		if (Wide.addBitField(&Bits[f], 1) > 0) {
+			Wides++;
+		}
+	}
+	Ok = Ok && (Wide.findFirstWritableRecord() == 0);
+	Bits[Limit - 1] = 1;
+	Wide.addRecord();
+	Wide.saveRecord();
+	Bits[Limit - 1] = 0;
+	
+	WideBoot.init();
+	WideBoot.setSchema(true);
+	for (f = 0; f < Limit; f++) {
+		WideBoot.addBitField(&Bits[f], 1);
+	}
+	Result = (int32_t) WideBoot.findFirstWritableRecord();
+	WideBoot.gotoRecord(1);
+	Ok = Ok && (Wides == Limit) && (Result == 1) && (WideBoot.getField(Bits[0], Limit) == 1) && (WideBoot.getField(Bits[0], Limit - 1) == 0);
+	
+	// a list that is already too long is refused
+	Plain.init();
+	for (f = 0; f < (MAX_FIELDS - 1); f++) {
+		Plain.addBitField(&Bits[f], 1);
+	}
+	Ok = Ok && (Plain.setSchema(true) == (Plain.getFieldCount() <= ((TEENSYDB_SCANBUFFER - 16) / 16)));
+	
+	printf("  %d fields from the chip, other field list refused, %d fields in a schema %s\n", Count, Wides, Ok ? "ok" : "FAILED");
+	
+}
+
+uint32_t TableErrors = 0;
+
+bool TableRecord(uint32_t Record) {
+	
+	// the slow table saved Time as 20 times its record number
+	if (Bench->getFieldValue(1) != (Record * 20)) {
+		TableErrors++;
+	}
+	
+	return true;
+	
+}
+
+void tableTest() {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB Fast(Flash);
+	TeensyDB Slow(Flash);
+	TeensyDB FastReboot(Flash);
+	TeensyDB SlowReboot(Flash);
+	uint64_t Start = 0;
+	uint32_t Time = 0;
+	float Pressure = 0;
+	uint32_t FastFound = 0;
+	uint32_t SlowFound = 0;
+	uint32_t i = 0;
+	bool Ok = true;
+	
+	// fast sensor records and a slow status record with other fields, one table each on the same chip
+	Fast.init();
+	Fast.setTable(1);
+	Fast.setSchema(true);
+	addFields(Fast);
+	Fast.setWriteCombine(true);
+	Fast.findFirstWritableRecord();
+	
+	Slow.init();
+	Slow.setTable(2);
+	Slow.setSchema(true);
+	Slow.addField(&Time);
+	Slow.addField(&Pressure);
+	Slow.findFirstWritableRecord();
+	
+	for (i = 1; i <= 20000; i++) {
+		Point = i;
+		Fast.addRecord();
+		Fast.saveRecord();
+		if ((i % 20) == 0) {
+			Time = i;
+			Pressure = i * 0.01f;
+			Slow.addRecord();
+			Slow.saveRecord();
+		}
+	}
+	Fast.flush();
+	Slow.flush();
+	
+	FastReboot.init();
+	FastReboot.setTable(1);
+	FastReboot.setSchema(true);
+	addFields(FastReboot);
+	FastFound = FastReboot.findFirstWritableRecord();
+	
+	SlowReboot.init();
+	SlowReboot.setTable(2);
+	SlowReboot.setSchema(true);
+	SlowReboot.addField(&Time);
+	SlowReboot.addField(&Pressure);
+	SlowFound = SlowReboot.findFirstWritableRecord();
+	
+	// only the slow table's sectors are read
+	Bench = &SlowReboot;
+	TableErrors = 0;
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	SlowReboot.scan(1, SlowReboot.getLastRecord(), TableRecord);
+	
+	printf("%-40s %12.0f us %8u cmds %8u bytes read  found %u + %u", "scan 1000 slow records of 21000, tables",
+		(double) (TeensyDBHostClock - Start) / 1000.0, Flash.Counters.Transactions, Flash.Counters.ReadBytes, FastFound, SlowFound);
+	
+	Ok = (FastFound == 20000) && (SlowFound == 1000) && (TableErrors == 0) && (Fast.getRecordLength() != SlowReboot.getRecordLength());
+	
+	// both carry on after the reboot
+	Point = 20001;
+	FastReboot.addRecord();
+	FastReboot.saveRecord();
+	Time = 20020;
+	SlowReboot.addRecord();
+	SlowReboot.saveRecord();
+	
+	FastReboot.gotoRecord(20000);
+	Ok = Ok && (FastReboot.getField(Point, fPoint) == 20000);
+	FastReboot.gotoRecord(20001);
+	Ok = Ok && (FastReboot.getField(Point, fPoint) == 20001);
+	SlowReboot.gotoRecord(1001);
+	Ok = Ok && (SlowReboot.getField(Time, 1) == 20020);
+	SlowReboot.gotoRecord(1);
+	Ok = Ok && (SlowReboot.getField(Time, 1) == 20);
+	
+	printf(" %s\n", Ok ? "ok" : "FAILED");
+	
+}
+
+struct Reading {
+	char Name[12];
+	uint8_t ID;
+	uint32_t Point;
+	float Volts;
+	int16_t Temp;
+};
+
+typedef TeensyDBTable<Reading,
+	TEENSYDB_FIELD(Reading, Name),
+	TEENSYDB_FIELD(Reading, ID),
+	TEENSYDB_FIELD(Reading, Point),
+	TEENSYDB_FIELD(Reading, Volts),
+	TEENSYDB_FIELD(Reading, Temp)> ReadingTable;
+
+// a chip that takes no time, so the encode time isn't lost in the simulator's
+class NullFlash : public TeensyDBDevice {
+	
+public:
+	
+	bool begin() { return true; }
+	void readJEDEC(uint8_t *ID) { ID[0] = 0xEF; ID[1] = 0x40; ID[2] = 0x17; }
+	void readUniqueID(uint8_t *ID) { memset(ID, 0, 8); }
+	void read(uint32_t, uint8_t *Buffer, uint32_t Length, bool = true) { memset(Buffer, 0xFF, Length); }
+	void program(uint32_t, const uint8_t *, uint32_t) {}
+	void erase(uint8_t, uint32_t) {}
+	uint8_t readStatus() { return 0; }
+	
+};
+
+double hostTime(std::chrono::steady_clock::time_point Start) {
+	
+	// PC time, ns
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+	
+}
+
+void typedTest() {
+	
+	TeensyDBSimFlash Flash[4];
+	NullFlash Null;
+	TeensyDB Runtime(Flash[0]);
+	TeensyDB Typed(Flash[1]);
+	TeensyDB Extra(Flash[2]);
+	TeensyDB Full(Flash[3]);
+	TeensyDB Timed(Null);
+	ReadingTable Readings(Typed);
+	ReadingTable RuntimeReadings(Runtime);
+	ReadingTable ExtraReadings(Extra);
+	ReadingTable FullReadings(Full);
+	ReadingTable TimedReadings(Timed);
+	Reading Record;
+	static char Pad[TEENSYDB_MAXREXORDLENGTH - 10];
+	std::chrono::steady_clock::time_point Start;
+	double RuntimeTime = 0, TypedTime = 0;
+	uint32_t Count = 100000;
+	uint32_t Errors = 0;
+	uint32_t Round = 0;
+	uint32_t i = 0;
+	
+	Runtime.init();
+	addFields(Runtime);
+	Runtime.findFirstWritableRecord();
+	
+	Typed.init();
+	Readings.begin();
+	Typed.findFirstWritableRecord();
+	
+	strcpy(Name, "sensor");
+	strcpy(Record.Name, "sensor");
+	ID = Record.ID = 7;
+	
+	// same bytes on the chip either way, the last name fills the field (no 0 on the end)
+	for (i = 1; i <= READ_RECORDS; i++) {
+		if (i == READ_RECORDS) {
+			memcpy(Name, "full length!", 12);
+			memcpy(Record.Name, Name, 12);
+		}
+		Point = Record.Point = i;
+		Volts = Record.Volts = i * 0.25f;
+		Temp = Record.Temp = i;
+		Runtime.addRecord();
+		Runtime.saveRecord();
+		Readings.save(Record);
+	}
+	strcpy(Name, "sensor");
+	
+	Errors = memcmp(Flash[0].getMemory(), Flash[1].getMemory(), (READ_RECORDS + 1) * Typed.getRecordLength());
+	
+	for (i = 1; i <= READ_RECORDS; i++) {
+		if ((!RuntimeReadings.read(i, Record)) || (Record.Point != i) || (Record.Volts != (i * 0.25f)) ||
+			(Record.Temp != (int16_t) i) || (Record.ID != 7) ||
+			(memcmp(Record.Name, (i == READ_RECORDS) ? "full length!" : "sensor", (i == READ_RECORDS) ? 12 : 7) != 0)) {
+			Errors++;
+		}
+	}
+	
+	// a table on an object with a field of its own saves and reads nothing, one that doesn't fit adds nothing
+	Extra.init();
+	Extra.addField(&ID);
+	Errors += ExtraReadings.begin() ? 0 : 1;
+	Extra.findFirstWritableRecord();
+	Extra.addRecord();
+	Extra.saveRecord();
+	Errors += (ExtraReadings.save(Record) || ExtraReadings.saveAsync(Record) || ExtraReadings.read(1, Record)) ? 1 : 0;
+	Errors += (Extra.getLastRecord() == 1) ? 0 : 1;
+	
+	Full.init();
+	Full.addField(Pad, sizeof(Pad));
+	Errors += (FullReadings.begin() || (Full.getFieldCount() != 1) || (Full.getRecordLength() != sizeof(Pad))) ? 1 : 0;
+	
+	// now the time on one chip that takes none, saveRecord (the table's fields through the runtime encoder)
+	// and TeensyDBTable, best of 15 (PC time is noisy). this is the whole save, the encode is only part of it,
+	// the record check, the write queue and the bookkeeping are the same both ways
+	Timed.init();
+	TimedReadings.begin();
+	Timed.setWriteCombine(true);
+	Timed.findFirstWritableRecord();
+	
+	RuntimeTime = TypedTime = 1.0e9;
+	
+	for (Round = 0; Round < 15; Round++) {
+		
+		Timed.eraseAll();
+		Start = std::chrono::steady_clock::now();
+		for (i = 1; i <= Count; i++) {
+			Timed.addRecord();
+			Timed.saveRecord();
+		}
+		RuntimeTime = fmin(RuntimeTime, hostTime(Start) / Count);
+		
+		Timed.eraseAll();
+		Start = std::chrono::steady_clock::now();
+		for (i = 1; i <= Count; i++) {
+			Record.Point = i;
+			TimedReadings.save(Record);
+		}
+		TypedTime = fmin(TypedTime, hostTime(Start) / Count);
+	}
+	
+	printf("%-40s %10.1f ns/record saveRecord %10.1f ns/record TeensyDBTable (PC time) %s\n",
+		"whole save path, chip takes no time", RuntimeTime, TypedTime, (Errors == 0) ? "ok" : "FAILED");
+	
+}
+
+uint32_t ViewErrors = 0;
+double ViewSum = 0;
+
+bool ViewRecord(uint32_t) {
+	
+	// the scanned record where it sits in the scan buffer
+	TeensyDBRecord Reading = Bench->getRecord();
+	uint16_t Length = 0;
+	const char *Text = Reading.getCharField(fName, Length);
+	
+	ViewSum = ViewSum + Reading.getField(Point, fPoint) + Reading.getField(Volts, fVolts) + Reading.getField(Temp, fTemp);
+	if ((Length != 6) || (memcmp(Text, "sensor", 6) != 0)) {
+		ViewErrors++;
+	}
+	
+	return true;
+	
+}
+
+bool FieldRecord(uint32_t) {
+	
+	ViewSum = ViewSum + Bench->getField(Point, fPoint) + Bench->getField(Volts, fVolts) + Bench->getField(Temp, fTemp);
+	if (strcmp(Bench->getCharField(fName), "sensor") != 0) {
+		ViewErrors++;
+	}
+	
+	return true;
+	
+}
+
+void viewTest() {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	TeensyDBRecord First, Last;
+	std::chrono::steady_clock::time_point Start;
+	double FieldTime = 0, ViewTime = 0;
+	double FieldSum = 0;
+	char Label[12];
+	uint16_t FirstLength = 0, LastLength = 0;
+	uint8_t fLabel = 0;
+	const char *FirstText;
+	const char *LastText;
+	uint32_t Count = 1000000;
+	uint32_t Round = 0;
+	uint32_t i = 0;
+	bool Ok = true;
+	
+	DB.init();
+	addFields(DB);
+	fLabel = DB.addField(Label, sizeof(Label));
+	DB.setRecordCheck(true);
+	DB.findFirstWritableRecord();
+	DB.setWriteCombine(true);
+	
+	strcpy(Name, "sensor");
+	for (i = 1; i <= READ_RECORDS; i++) {
+		Point = i;
+		Volts = i * 0.25f;
+		Temp = (int16_t) i - 500;
+		snprintf(Label, sizeof(Label), "label %u", i);
+		DB.addRecord();
+		DB.saveRecord();
+	}
+	DB.flush();
+	
+	// two char fields of one record at once, stng would hold only the last
+	First = DB.getRecord(7);
+	FirstText = First.getCharField(fName, FirstLength);
+	LastText = First.getCharField(fLabel, LastLength);
+	Ok = First.isValid() && (FirstLength == 6) && (strncmp(FirstText, "sensor", FirstLength) == 0) &&
+		(LastLength == 7) && (strncmp(LastText, "label 7", LastLength) == 0) && (First.getField(Temp, fTemp) == -493) &&
+		(First.getField(Volts, fVolts) == 1.75f) && (First.getFieldValue(fPoint) == 7.0);
+	
+	// out of range is an invalid view, the current record doesn't move
+	DB.gotoRecord(20);
+	Last = DB.getRecord(READ_RECORDS + 1);
+	Ok = Ok && (!Last.isValid()) && (DB.getRecord().getField(Point, fPoint) == 20) && (DB.getField(Point, fPoint) == 20);
+	
+	// views of the scan buffer give the same fields as getField
+	Bench = &DB;
+	ViewErrors = 0;
+	ViewSum = 0;
+	DB.scan(1, READ_RECORDS, FieldRecord);
+	FieldSum = ViewSum;
+	ViewSum = 0;
+	DB.scan(1, READ_RECORDS, ViewRecord);
+	Ok = Ok && (ViewErrors == 0) && (ViewSum == FieldSum);
+	
+	// what a trend display redrawing from records already read pays per record, 3 fields and a name through
+	// getField and getCharField against a view, best of 15 (PC time)
+	DB.gotoRecord(7);
+	First = DB.getRecord();
+	FieldTime = ViewTime = 1.0e9;
+	for (Round = 0; Round < 15; Round++) {
+		
+		FieldSum = 0;
+		Start = std::chrono::steady_clock::now();
+		for (i = 0; i < Count; i++) {
+			FieldSum = FieldSum + DB.getField(Point, fPoint) + DB.getField(Volts, fVolts) + DB.getField(Temp, fTemp) +
+				strlen(DB.getCharField(fName));
+		}
+		FieldTime = fmin(FieldTime, hostTime(Start) / Count);
+		
+		ViewSum = 0;
+		Start = std::chrono::steady_clock::now();
+		for (i = 0; i < Count; i++) {
+			First.getCharField(fName, FirstLength);
+			ViewSum = ViewSum + First.getField(Point, fPoint) + First.getField(Volts, fVolts) + First.getField(Temp, fTemp) +
+				FirstLength;
+		}
+		ViewTime = fmin(ViewTime, hostTime(Start) / Count);
+	}
+	
+	Ok = Ok && (ViewSum == FieldSum);
+	
+	printf("%-40s %10.1f ns/record getField %10.1f ns/record view (PC time) %s\n",
+		"read 3 fields and a name of a record", FieldTime, ViewTime, Ok ? "ok" : "FAILED");
+	
+}
+
+void limitTest() {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	uint32_t Channel[MAX_FIELDS];
+	char Text[TEENSYDB_MAXREXORDLENGTH];
+	uint8_t Extra = 0;
+	uint8_t Count = 0;
+	uint8_t f = 0;
+	bool Ok = true;
+	
+	// field numbers are 1 based, so MAX_FIELDS - 1 fields fit and the next one is turned away
+	DB.init();
+	for (f = 0; f < MAX_FIELDS; f++) {
+		if (DB.addField(&Channel[f]) > 0) {
+			Count++;
+		}
+	}
+	Ok = (Count == (MAX_FIELDS - 1)) && (DB.getFieldCount() == (MAX_FIELDS - 1));
+	
+	// a record as long as the buffers, then not one byte more
+	DB.init();
+	Ok = Ok && (DB.addField(Text, sizeof(Text)) == 1) && (DB.addField(&Extra) == 0) &&
+		(DB.getRecordLength() == TEENSYDB_MAXREXORDLENGTH);
+	
+	// and getCharField gives all of it back
+	memset(Text, 'x', sizeof(Text));
+	DB.findFirstWritableRecord();
+	DB.addRecord();
+	DB.saveRecord();
+	DB.gotoRecord(1);
+	Ok = Ok && (strlen(DB.getCharField(1)) == sizeof(Text));
+	
+	printf("  %d fields, %d byte record, one more refused %s\n", Count, DB.getRecordLength(), Ok ? "ok" : "FAILED");
+	
+}
+
+/*
+
+benchmark suite, parameterised runs with machine readable results so a change can be compared against a baseline
+(./hostbench -suite -csv > after.csv, then diff against the numbers from before). every figure is simulated bus and
+chip time, so the same build gives the same numbers on any PC
+
+	-suite		run the suite instead of the report above
+	-csv		results as CSV (scenario,param,value,metric,result)
+	-json		results as a JSON array
+	-clock Hz	SPI clock of the simulated chip
+	-setup ns	chip select and setup time per command
+	-program ns	page program time, fixed part
+	-erase us	sector erase time
+
+record lengths run from 4 bytes up to TEENSYDB_MAXREXORDLENGTH, build with -DTEENSYDB_MAXREXORDLENGTH=256 for all of them
+
+*/
+
+#define SUITE_RECORDS 2000
+#define SUITE_RESULTS 512
+
+struct SuiteResult {
+	const char *Scenario;
+	const char *Param;
+	uint32_t Value;
+	const char *Metric;
+	double Result;
+};
+
+TeensyDBSimTiming SuiteTiming;
+SuiteResult Results[SUITE_RESULTS];
+uint16_t ResultCount = 0;
+uint32_t SuiteErrors = 0;
+uint32_t SuiteSeed = 1;
+char Pad[TEENSYDB_MAXREXORDLENGTH];
+
+void result(const char *Scenario, const char *Param, uint32_t Value, const char *Metric, double Result) {
+	
+	if (ResultCount < SUITE_RESULTS) {
+		Results[ResultCount].Scenario = Scenario;
+		Results[ResultCount].Param = Param;
+		Results[ResultCount].Value = Value;
+		Results[ResultCount].Metric = Metric;
+		Results[ResultCount].Result = Result;
+		ResultCount++;
+	}
+	
+}
+
+double simTime(uint64_t Start) {
+	
+	// simulated time, us
+	return (double) (TeensyDBHostClock - Start) / 1000.0;
+	
+}
+
+// same numbers every run
+uint32_t suiteRandom() {
+	
+	SuiteSeed = (SuiteSeed * 1103515245UL) + 12345UL;
+	
+	return SuiteSeed >> 8;
+	
+}
+
+// a record of Length bytes, Point then padding
+void suiteFields(TeensyDB &DB, uint16_t Length) {
+	
+	memset(Pad, 'x', sizeof(Pad));
+	DB.init();
+	fPoint = DB.addField(&Point);
+	if (Length > 4) {
+		DB.addField(Pad, Length - 4);
+	}
+	
+}
+
+void suiteWrite(uint16_t Length, bool Combine) {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	const char *Mode = Combine ? "combine" : "save";
+	uint64_t Start = 0;
+	double us = 0;
+	uint32_t Spanning = 0;
+	uint32_t i = 0;
+	
+	Flash.Timing = SuiteTiming;
+	suiteFields(DB, Length);
+	DB.setWriteCombine(Combine);
+	DB.findFirstWritableRecord();
+	
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	for (i = 1; i <= SUITE_RECORDS; i++) {
+		Point = i;
+		DB.addRecord();
+		DB.saveRecord();
+		if ((((i * Length) % 256) + Length) > 256) {
+			Spanning++;
+		}
+	}
+	DB.flush();
+	us = simTime(Start);
+	
+	DB.gotoRecord(SUITE_RECORDS);
+	if ((DB.getField(Point, fPoint) != SUITE_RECORDS) || (Flash.Counters.ProgramViolations > 0)) {
+		SuiteErrors++;
+	}
+	
+	result("write", Mode, Length, "us_per_record", us / SUITE_RECORDS);
+	result("write", Mode, Length, "bytes_per_s", (SUITE_RECORDS * Length * 1000000.0) / us);
+	result("write", Mode, Length, "cmds_per_record", (double) Flash.Counters.Transactions / SUITE_RECORDS);
+	result("write", Mode, Length, "programs_per_record", (double) Flash.Counters.Programs / SUITE_RECORDS);
+	result("write", Mode, Length, "page_spanning_pct", (Spanning * 100.0) / SUITE_RECORDS);
+	
+}
+
+void suiteBoot(uint8_t Percent) {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	uint64_t Start = 0;
+	uint32_t Records = 0;
+	
+	// the chip is filled directly, record 0 is never used and the last whole record is held back (findMaxRecords)
+	Flash.Timing = SuiteTiming;
+	suiteFields(DB, 16);
+	Records = (uint32_t) (((uint64_t) ((Flash.getSize() / 16) - 2) * Percent) / 100);
+	memset(Flash.getMemory() + 16, 0x00, Records * 16);
+	
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	DB.findFirstWritableRecord();
+	
+	if (DB.getLastRecord() != Records) {
+		SuiteErrors++;
+	}
+	
+	result("boot", "fill_pct", Percent, "us", simTime(Start));
+	result("boot", "fill_pct", Percent, "cmds", Flash.Counters.Transactions);
+	
+}
+
+void suiteRead(uint16_t Length) {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	uint64_t Start = 0;
+	uint32_t Records = 20000;
+	uint32_t Record = 0;
+	uint32_t i = 0;
+	uint8_t Lanes = 0;
+	
+	Flash.Timing = SuiteTiming;
+	suiteFields(DB, Length);
+	DB.setWriteCombine(true);
+	DB.findFirstWritableRecord();
+	for (i = 1; i <= Records; i++) {
+		Point = i;
+		DB.addRecord();
+		DB.saveRecord();
+	}
+	DB.flush();
+	
+	// sequential export, one record at a time then streamed by scan on 1, 2 and 4 lines
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	for (i = 1; i <= Records; i++) {
+		DB.gotoRecord(i);
+		if (DB.getField(Point, fPoint) != i) {
+			SuiteErrors++;
+		}
+	}
+	result("export", "gotoRecord", Length, "us_per_record", simTime(Start) / Records);
+	result("export", "gotoRecord", Length, "cmds", Flash.Counters.Transactions);
+	
+	Bench = &DB;
+	for (Lanes = 1; Lanes <= 4; Lanes = Lanes * 2) {
+		DB.setReadLanes(Lanes);
+		ScanCount = 0;
+		Flash.resetCounters();
+		Start = TeensyDBHostClock;
+		DB.scan(1, Records, ScanRecord);
+		if (ScanCount != Records) {
+			SuiteErrors++;
+		}
+		result("export", (Lanes == 1) ? "scan" : ((Lanes == 2) ? "scan_dual" : "scan_quad"), Length, "us_per_record", simTime(Start) / Records);
+		result("export", (Lanes == 1) ? "scan" : ((Lanes == 2) ? "scan_dual" : "scan_quad"), Length, "bytes_per_s",
+			(Records * Length * 1000000.0) / simTime(Start));
+	}
+	DB.setReadLanes(1);
+	
+	// random access
+	SuiteSeed = 1;
+	Flash.resetCounters();
+	Start = TeensyDBHostClock;
+	for (i = 0; i < SUITE_RECORDS; i++) {
+		Record = (suiteRandom() % Records) + 1;
+		DB.gotoRecord(Record);
+		if (DB.getField(Point, fPoint) != Record) {
+			SuiteErrors++;
+		}
+	}
+	result("random", "gotoRecord", Length, "us_per_read", simTime(Start) / SUITE_RECORDS);
+	result("random", "gotoRecord", Length, "cmds_per_read", (double) Flash.Counters.Transactions / SUITE_RECORDS);
+	
+}
+
+void suiteErase() {
+	
+	TeensyDBSimFlash Flash;
+	TeensyDB DB(Flash);
+	uint64_t Start = 0;
+	uint32_t i = 0;
+	
+	Flash.Timing = SuiteTiming;
+	suiteFields(DB, 16);
+	DB.findFirstWritableRecord();
+	
+	Start = TeensyDBHostClock;
+	for (i = 0; i < 16; i++) {
+		DB.eraseSector(i);
+	}
+	result("erase", "sector", 4096, "us", simTime(Start) / 16);
+	
+	Start = TeensyDBHostClock;
+	for (i = 0; i < 4; i++) {
+		DB.eraseSmallBlock(i);
+	}
+	result("erase", "small_block", 32768, "us", simTime(Start) / 4);
+	
+	Start = TeensyDBHostClock;
+	for (i = 0; i < 4; i++) {
+		DB.eraseLargeBlock(i);
+	}
+	result("erase", "large_block", 65536, "us", simTime(Start) / 4);
+	
+	Start = TeensyDBHostClock;
+	DB.eraseAll();
+	result("erase", "chip", Flash.getSize(), "us", simTime(Start));
+	
+}
+
+int suite(uint8_t Format) {
+	
+	static const uint16_t Lengths[] = { 4, 8, 16, 32, 64, 100, 128, 200, 255, 256 };
+	static const uint8_t Levels[] = { 0, 1, 10, 25, 50, 75, 90, 99, 100 };
+	uint16_t i = 0;
+	
+	for (i = 0; i < (sizeof(Lengths) / sizeof(Lengths[0])); i++) {
+		if (Lengths[i] <= TEENSYDB_MAXREXORDLENGTH) {
+			suiteWrite(Lengths[i], false);
+			suiteWrite(Lengths[i], true);
+		}
+	}
+	for (i = 0; i < sizeof(Levels); i++) {
+		suiteBoot(Levels[i]);
+	}
+	suiteRead(16);
+	suiteRead(64);
+	suiteErase();
+	
+	// the errors go in the results too, a run that read back wrong data isn't a baseline
+	result("check", "errors", 0, "count", SuiteErrors);
+	
+	if (Format == 1) {
+		printf("scenario,param,value,metric,result\n");
+		for (i = 0; i < ResultCount; i++) {
+			printf("%s,%s,%u,%s,%.10g\n", Results[i].Scenario, Results[i].Param, Results[i].Value, Results[i].Metric, Results[i].Result);
+		}
+	}
+	else if (Format == 2) {
+		printf("[\n");
+		for (i = 0; i < ResultCount; i++) {
+			printf("  {\"scenario\": \"%s\", \"param\": \"%s\", \"value\": %u, \"metric\": \"%s\", \"result\": %.10g}%s\n", Results[i].Scenario,
+				Results[i].Param, Results[i].Value, Results[i].Metric, Results[i].Result, (i < (ResultCount - 1)) ? "," : "");
+		}
+		printf("]\n");
+	}
+	else {
+		for (i = 0; i < ResultCount; i++) {
+			printf("%-8s %-12s %9u  %-20s %14.3f\n", Results[i].Scenario, Results[i].Param, Results[i].Value, Results[i].Metric, Results[i].Result);
+		}
+	}
+	
+	return (SuiteErrors == 0) ? 0 : 1;
+	
+}
+
+int main(int argc, char **argv) {
+	
+	bool Suite = false;
+	uint8_t Format = 0;
+	int i = 0;
+	
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-suite") == 0) {
+			Suite = true;
+		}
+		else if (strcmp(argv[i], "-csv") == 0) {
+			Suite = true;
+			Format = 1;
+		}
+		else if (strcmp(argv[i], "-json") == 0) {
+			Suite = true;
+			Format = 2;
+		}
+		else if ((strcmp(argv[i], "-clock") == 0) && ((i + 1) < argc)) {
+			SuiteTiming.ClockHz = strtoul(argv[++i], NULL, 10);
+		}
+		else if ((strcmp(argv[i], "-setup") == 0) && ((i + 1) < argc)) {
+			SuiteTiming.TransactionNs = strtoul(argv[++i], NULL, 10);
+		}
+		else if ((strcmp(argv[i], "-program") == 0) && ((i + 1) < argc)) {
+			SuiteTiming.ProgramBaseNs = strtoul(argv[++i], NULL, 10);
+		}
+		else if ((strcmp(argv[i], "-erase") == 0) && ((i + 1) < argc)) {
+			SuiteTiming.SectorEraseUs = strtoul(argv[++i], NULL, 10);
+		}
+		else {
+			printf("usage: hostbench [-suite] [-csv | -json] [-clock Hz] [-setup ns] [-program ns] [-erase us]\n");
+			return 2;
+		}
+	}
+	
+	if (Suite) {
+		return suite(Format);
+	}
+	
+	printf("TeensyDB host benchmark, simulated W25Q64JV at 25 MHz\n\n");
+	
+	chipTest(0x62, 0x06, 0x13);
+	chipTest(0xEF, 0x40, 0x17);
+	chipTest(0xEF, 0x40, 0x19);
+	chipTest(0xEF, 0x40, 0x20);
+	chipTest(0xC2, 0x20, 0x16);
+	printf("\n");
+	
+	writeTest("save 5000 records", false);
+	writeTest("save 5000 records, write combining", true);
+	readTests();
+	bitTest("save 5000 records, byte fields", false);
+	bitTest("save 5000 records, bit and scaled fields", true);
+	typedTest();
+	viewTest();
+	printf("\n");
+	bootTest("find end of 40000 records, bisect", 0);
+	bootTest("find end of 40000 records, checkpoint", 64);
+	ringTest("ring, 60000 records on 512 KB, async", 0x06, 0x13, 60000, 100);
+	ringTest("ring, 150000 records on 2 MB, 500 us", 0x40, 0x15, 150000, 500);
+	statsTest();
+	powerTest("ring, power lost in the erase ahead", 0x06, 0x13, false);
+	powerTest("ring, power lost, erase ahead suspended", 0x40, 0x15, true);
+	tornTest();
+	schemaTest();
+	limitTest();
+	tableTest();
+	eraseTest("erase 4 MB in the background, async", 0x40, 0x17, true);
+	eraseTest("erase 4 MB in the background, saveRecord", 0x40, 0x17, false);
+	eraseTest("erase 256 KB, chip can't suspend", 0x06, 0x13, true);
+	keyTest("seek key in 40000 records", false);
+	keyTest("seek key in 40000 records, index", true);
+	zoneTest("Temp > 1000 in 100000 records", false);
+	zoneTest("Temp > 1000 in 100000 records, zone map", true);
+	compressTest("20000 sensor records", false);
+	compressTest("20000 sensor records, compressed", true);
+	
+	return 0;
+	
+}
@@ -0,0 +1,54 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+#include "TeensyDBHost.h"
+
+uint64_t TeensyDBHostClock = 0;
+
+TeensyDBHostSerial Serial;
+
+uint32_t millis() {
+	
+	return (uint32_t) (TeensyDBHostClock / 1000000ULL);
+	
+}
+
+uint32_t micros() {
+	
+	return (uint32_t) (TeensyDBHostClock / 1000ULL);
+	
+}
+
+void delay(uint32_t ms) {
+	
+	TeensyDBHostClock = TeensyDBHostClock + (ms * 1000000ULL);
+	
+}
+
+void delayMicroseconds(uint32_t us) {
+	
+	TeensyDBHostClock = TeensyDBHostClock + (us * 1000ULL);
+	
+}
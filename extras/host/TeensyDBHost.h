@@ -0,0 +1,78 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+/*
+
+just enough of the Arduino core to build TeensyDB on a PC against TeensyDBSimFlash.
+time is simulated, the simulated chip moves the clock forward for every SPI transfer, program and erase
+so millis() / micros() report what the same operations would take on real hardware (bus and chip time, not CPU time)
+
+*/
+
+#ifndef TEENSYDB_HOST_H
+#define TEENSYDB_HOST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// on a PC int and int32_t are the same type so the int overloads would collide
+#define TEENSYDB_NO_INT_OVERLOAD
+
+typedef uint8_t byte;
+
+// simulated time in ns
+extern uint64_t TeensyDBHostClock;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// stand in for Serial, prints to stdout
+class TeensyDBHostSerial {
+	
+public:
+
+	void print(const char *Text) { printf("%s", Text); }
+	void print(char Data) { printf("%c", Data); }
+	void print(unsigned char Data) { printf("%u", Data); }
+	void print(int Data) { printf("%d", Data); }
+	void print(unsigned int Data) { printf("%u", Data); }
+	void print(long Data) { printf("%ld", Data); }
+	void print(unsigned long Data) { printf("%lu", Data); }
+	void print(double Data, int Digits = 2) { printf("%.*f", Digits, Data); }
+	
+	template <typename T> void println(T Data) { print(Data); printf("\n"); }
+	void println(double Data, int Digits = 2) { print(Data, Digits); printf("\n"); }
+	void println() { printf("\n"); }
+	
+};
+
+extern TeensyDBHostSerial Serial;
+
+#endif
@@ -0,0 +1,349 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+#include "TeensyDBSimFlash.h"
+
+TeensyDBSimFlash::TeensyDBSimFlash(uint8_t Manufacturer, uint8_t Type, uint8_t Capacity) {
+	
+	JEDECID[0] = Manufacturer;
+	JEDECID[1] = Type;
+	JEDECID[2] = Capacity;
+	
+	// the physical chip, independent of the profile TeensyDB picks
+	TeensyDBFindChip(JEDECID, &Geometry);
+	
+	Size = Geometry.Capacity;
+	Memory = (uint8_t *) malloc(Size);
+	
+	// a new chip comes erased
+	memset(Memory, 0xFF, Size);
+	
+}
+
+TeensyDBSimFlash::~TeensyDBSimFlash() {
+	
+	free(Memory);
+	
+}
+
+bool TeensyDBSimFlash::begin() {
+	
+	return true;
+	
+}
+
+void TeensyDBSimFlash::readJEDEC(uint8_t *ID) {
+	
+	busTime(4);
+	
+	ID[0] = JEDECID[0];
+	ID[1] = JEDECID[1];
+	ID[2] = JEDECID[2];
+	
+}
+
+void TeensyDBSimFlash::readUniqueID(uint8_t *ID) {
+	
+	uint8_t i = 0;
+	
+	busTime(13);
+	
+	for (i = 0; i < 8; i++) {
+		ID[i] = 0xA0 + i;
+	}
+	
+}
+
+void TeensyDBSimFlash::read(uint32_t Address, uint8_t *Buffer, uint32_t Length, bool) {
+	
+	uint32_t i = 0;
+	
+	// command, address, dummy byte, then the data on 1, 2 or 4 lines
+	busTime(1 + Geometry.AddressBytes + 1, Length);
+	
+	Counters.Reads++;
+	Counters.ReadBytes = Counters.ReadBytes + Length;
+	
+	if (busy()) {
+		memset(Buffer, 0xFF, Length);
+		return;
+	}
+	
+	inSuspended(Address, Length);
+	
+	// reads run on through the whole chip and wrap at the end
+	for (i = 0; i < Length; i++) {
+		Buffer[i] = Memory[(Address + i) % Size];
+	}
+	
+}
+
+void TeensyDBSimFlash::program(uint32_t Address, const uint8_t *Buffer, uint32_t Length) {
+	
+	uint32_t PageStart = 0;
+	uint32_t Offset = 0;
+	uint32_t i = 0;
+	uint8_t *Byte;
+	
+	// write enable, then command, address and the data
+	busTime(1);
+	busTime(1 + Geometry.AddressBytes + Length);
+	
+	if (busy()) {
+		return;
+	}
+	
+	Counters.Programs++;
+	Counters.ProgramBytes = Counters.ProgramBytes + Length;
+	
+	inSuspended(Address, Length);
+	
+	if (Length > Geometry.PageSize) {
+		Counters.ProgramViolations++;
+	}
+	
+	Address = Address % Size;
+	PageStart = Address - (Address % Geometry.PageSize);
+	Offset = Address % Geometry.PageSize;
+	
+	for (i = 0; i < Length; i++) {
+		
+		// the address counter wraps inside the page
+		Byte = &Memory[PageStart + ((Offset + i) % Geometry.PageSize)];
+		
+		// programming can only clear bits
+		if ((Buffer[i] & ~(*Byte)) != 0) {
+			Counters.ProgramViolations++;
+		}
+		
+		*Byte = *Byte & Buffer[i];
+	}
+	
+	BusyUntil = TeensyDBHostClock + Timing.ProgramBaseNs + ((uint64_t) Timing.ProgramByteNs * Length);
+	
+}
+
+void TeensyDBSimFlash::erase(uint8_t Type, uint32_t Address) {
+	
+	uint32_t BlockSize = Geometry.SectorSize;
+	uint64_t EraseTime = 0;
+	
+	// write enable, then command and address
+	busTime(1);
+	busTime(1 + Geometry.AddressBytes);
+	
+	if (busy()) {
+		return;
+	}
+	
+	// a suspended chip won't start another erase
+	if (Suspended) {
+		Counters.SuspendViolations++;
+		return;
+	}
+	
+	if (Type == ERASE_CHIP) {
+		Counters.ChipErases++;
+		memset(Memory, 0xFF, Size);
+		BusyUntil = TeensyDBHostClock + ((uint64_t) Timing.ChipEraseMs * 1000000ULL);
+		EraseLength = 0;
+		return;
+	}
+	
+	if (Type == ERASE_SMALLBLOCK) {
+		Counters.SmallBlockErases++;
+		BlockSize = Geometry.SmallBlockSize;
+		EraseTime = (uint64_t) Timing.SmallBlockEraseUs * 1000ULL;
+	}
+	else if (Type == ERASE_LARGEBLOCK) {
+		Counters.LargeBlockErases++;
+		BlockSize = Geometry.LargeBlockSize;
+		EraseTime = (uint64_t) Timing.LargeBlockEraseUs * 1000ULL;
+	}
+	else {
+		Counters.SectorErases++;
+		EraseTime = (uint64_t) Timing.SectorEraseUs * 1000ULL;
+	}
+	
+	// the chip ignores the low address bits
+	Address = Address % Size;
+	Address = Address - (Address % BlockSize);
+	
+	memset(&Memory[Address], 0xFF, BlockSize);
+	
+	BusyUntil = TeensyDBHostClock + EraseTime;
+	
+	EraseStart = Address;
+	EraseLength = BlockSize;
+	EraseUntil = BusyUntil;
+	
+}
+
+uint8_t TeensyDBSimFlash::readStatus() {
+	
+	busTime(2);
+	
+	Counters.StatusPolls++;
+	
+	if (TeensyDBHostClock < BusyUntil) {
+		// busy and write enable latch
+		return STAT_WIP | 0x02;
+	}
+	
+	return 0;
+	
+}
+
+bool TeensyDBSimFlash::suspend() {
+	
+	busTime(1);
+	
+	if (Geometry.SuspendCmd == 0x00) {
+		return false;
+	}
+	
+	Counters.Suspends++;
+	
+	// only a running sector or block erase stops, anything else is a no op
+	if ((!Suspended) && (EraseLength > 0) && (TeensyDBHostClock < EraseUntil)) {
+		EraseLeft = EraseUntil - TeensyDBHostClock;
+		Suspended = true;
+		BusyUntil = TeensyDBHostClock + ((uint64_t) Timing.SuspendUs * 1000ULL);
+	}
+	
+	return true;
+	
+}
+
+void TeensyDBSimFlash::resume() {
+	
+	busTime(1);
+	
+	if (Geometry.ResumeCmd == 0x00) {
+		return;
+	}
+	
+	Counters.Resumes++;
+	
+	// a program done while suspended has to finish first
+	if (busy()) {
+		return;
+	}
+	
+	if (Suspended) {
+		Suspended = false;
+		EraseUntil = TeensyDBHostClock + EraseLeft;
+		BusyUntil = EraseUntil;
+	}
+	
+}
+
+uint8_t TeensyDBSimFlash::setReadLanes(uint8_t Lanes) {
+	
+	// same rules as the real chip, limited by the dual and quad read codes in its profile
+	ReadLanes = 1;
+	
+	if ((Lanes >= 4) && (Geometry.QuadReadCmd != 0x00)) {
+		ReadLanes = 4;
+	}
+	else if ((Lanes >= 2) && (Geometry.DualReadCmd != 0x00)) {
+		ReadLanes = 2;
+	}
+	
+	return ReadLanes;
+	
+}
+
+void TeensyDBSimFlash::resetCounters() {
+	
+	Counters = TeensyDBSimCounters();
+	
+}
+
+void TeensyDBSimFlash::powerLoss() {
+	
+	if ((EraseLength > 0) && (Suspended || (TeensyDBHostClock < EraseUntil))) {
+		memset(&Memory[EraseStart], 0x00, EraseLength / 2);
+	}
+	
+	BusyUntil = 0;
+	EraseLength = 0;
+	Suspended = false;
+	
+}
+
+bool TeensyDBSimFlash::isSuspended() {
+	
+	return Suspended;
+	
+}
+
+uint8_t *TeensyDBSimFlash::getMemory() {
+	
+	return Memory;
+	
+}
+
+uint32_t TeensyDBSimFlash::getSize() {
+	
+	return Size;
+	
+}
+
+void TeensyDBSimFlash::busTime(uint32_t Bytes, uint32_t DataBytes) {
+	
+	// dual and quad reads mean the chip is on the bit banged bus
+	uint64_t Hz = (ReadLanes > 1) ? Timing.BitBangHz : Timing.ClockHz;
+	
+	Counters.Transactions++;
+	
+	TeensyDBHostClock = TeensyDBHostClock + Timing.TransactionNs + (((uint64_t) Bytes * 8000000000ULL) / Hz);
+	TeensyDBHostClock = TeensyDBHostClock + (((uint64_t) DataBytes * 8000000000ULL) / (Hz * ReadLanes));
+	
+}
+
+bool TeensyDBSimFlash::busy() {
+	
+	if (TeensyDBHostClock < BusyUntil) {
+		Counters.BusyViolations++;
+		return true;
+	}
+	
+	return false;
+	
+}
+
+bool TeensyDBSimFlash::inSuspended(uint32_t Address, uint32_t Length) {
+	
+	Address = Address % Size;
+	
+	if (Suspended && (Address < (EraseStart + EraseLength)) && ((Address + Length) > EraseStart)) {
+		Counters.SuspendViolations++;
+		return true;
+	}
+	
+	return false;
+	
+}
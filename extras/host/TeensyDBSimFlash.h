@@ -0,0 +1,142 @@
+/*
+  The MIT License (MIT)
+
+  library writen by Kris Kasprzak
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of
+  this software and associated documentation files (the "Software"), to deal in
+  the Software without restriction, including without limitation the rights to
+  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+  the Software, and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+  On a personal note, if you develop an application or product using this library
+  and make millions of dollars, I'm happy for you!
+
+*/
+
+/*
+
+a simulated SPI NOR flash chip for running TeensyDB on a PC. it behaves like the real thing where it matters
+
+1. programming can only clear bits (1 -> 0), erasing sets them back to 0xFF
+2. a program wraps around inside its page if it runs past the end of the page
+3. erases work on aligned sectors / blocks, the low address bits are ignored
+4. the chip is busy (WIP) for a realistic program and erase time, commands while busy are ignored
+5. a sector or block erase can be suspended (if the profile has the codes), then only reads and programs outside
+   the block being erased are allowed until it's resumed
+
+every operation moves the simulated clock forward (see TeensyDBHost.h) and is counted, so throughput and
+command counts can be measured without hardware. the chip is picked by JEDEC ID from the profile table
+(TeensyDBChip.cpp) for its size and geometry, the default is a Winbond W25Q64JV. timing is set in Timing. only
+TeensyDBBitBangBus reads on more than one line, so with setReadLanes above 1 every command is timed at BitBangHz
+
+*/
+
+#ifndef TEENSYDB_SIMFLASH_H
+#define TEENSYDB_SIMFLASH_H
+
+#include "TeensyDB.h"
+
+struct TeensyDBSimTiming {
+	uint32_t ClockHz = 25000000;		// SPI clock
+	uint32_t BitBangHz = 5000000;		// clock of the bit banged bus that does dual and quad reads, a guess, measure yours
+	uint32_t TransactionNs = 500;		// chip select and transaction setup per command
+	uint32_t ProgramBaseNs = 80000;		// page program, fixed part
+	uint32_t ProgramByteNs = 1250;		// page program, per byte (0.4 ms for a full page)
+	uint32_t SectorEraseUs = 45000;
+	uint32_t SmallBlockEraseUs = 120000;
+	uint32_t LargeBlockEraseUs = 150000;
+	uint32_t ChipEraseMs = 20000;
+	uint32_t SuspendUs = 20;			// erase suspend until the chip is ready
+};
+
+struct TeensyDBSimCounters {
+	uint32_t Transactions = 0;
+	uint32_t Reads = 0;
+	uint32_t ReadBytes = 0;
+	uint32_t Programs = 0;
+	uint32_t ProgramBytes = 0;
+	uint32_t SectorErases = 0;
+	uint32_t SmallBlockErases = 0;
+	uint32_t LargeBlockErases = 0;
+	uint32_t ChipErases = 0;
+	uint32_t StatusPolls = 0;
+	uint32_t BusyViolations = 0;		// command sent while the chip was busy
+	uint32_t ProgramViolations = 0;		// program tried to set a bit (0 -> 1) or ran past a page
+	uint32_t Suspends = 0;
+	uint32_t Resumes = 0;
+	uint32_t SuspendViolations = 0;		// read or program in the suspended block, or an erase while suspended
+};
+
+class TeensyDBSimFlash : public TeensyDBDevice {
+	
+public:
+
+	TeensyDBSimFlash(uint8_t Manufacturer = 0xEF, uint8_t Type = 0x40, uint8_t Capacity = 0x17);
+	~TeensyDBSimFlash();
+	
+	bool begin();
+	void readJEDEC(uint8_t *ID);
+	void readUniqueID(uint8_t *ID);
+	void read(uint32_t Address, uint8_t *Buffer, uint32_t Length, bool Wait = true);
+	void program(uint32_t Address, const uint8_t *Buffer, uint32_t Length);
+	void erase(uint8_t Type, uint32_t Address);
+	uint8_t readStatus();
+	bool suspend();
+	void resume();
+	uint8_t setReadLanes(uint8_t Lanes);
+	
+	// method to clear the operation counters
+	void resetCounters();
+	
+	// method to cut the power, an erase that hadn't finished (running or suspended) leaves its block neither
+	// erased nor as it was, here the first half of it reads 0x00
+	void powerLoss();
+	
+	// method to see if an erase is suspended
+	bool isSuspended();
+	
+	// direct access to the simulated memory, for checking results
+	uint8_t *getMemory();
+	uint32_t getSize();
+	
+	TeensyDBSimTiming Timing;
+	TeensyDBSimCounters Counters;
+	
+private:
+
+	uint8_t *Memory;
+	uint32_t Size;
+	TeensyDBChipProfile Geometry;
+	uint64_t BusyUntil = 0;
+	
+	// the last sector or block erase, and what's left of it while it's suspended
+	uint32_t EraseStart = 0;
+	uint32_t EraseLength = 0;
+	uint64_t EraseUntil = 0;
+	uint64_t EraseLeft = 0;
+	bool Suspended = false;
+	uint8_t JEDECID[3];
+	
+	// method to move the clock forward for one command of Bytes bytes on one line
+	// followed by DataBytes on ReadLanes lines
+	void busTime(uint32_t Bytes, uint32_t DataBytes = 0);
+	
+	// method to see if the chip is busy, counts it if a command arrived anyway
+	bool busy();
+	
+	// method to see if an access lands in a suspended erase, counts it if it does
+	bool inSuspended(uint32_t Address, uint32_t Length);
+	
+};
+
+#endif